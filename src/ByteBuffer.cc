@@ -40,7 +40,7 @@ void ByteBuffer::setByteOrder(int byteOrder) {
 }
 
 uint8_t* ByteBuffer::getBytes() {
-	return reinterpret_cast<uint8_t*>(this->buf.data());
+	return this->buf.data();
 }
 
 size_t ByteBuffer::getSize() {
@@ -131,10 +131,10 @@ bool ByteBuffer::putBoolean(bool b) {
 }
 
 bool ByteBuffer::putBoolean(bool b, size_t pos) {
-	return putByte(static_cast<uint16_t>(b == true), pos);
+	return putByte(static_cast<uint8_t>(b == true), pos);
 }
 
-bool ByteBuffer::putByte(uint16_t var) {
+bool ByteBuffer::putByte(uint8_t var) {
 	if (inRange(curPos)) {
 		buf[curPos] = var;
 		move(1);
@@ -145,7 +145,7 @@ bool ByteBuffer::putByte(uint16_t var) {
   return false;
 }
 
-bool ByteBuffer::putByte(uint16_t var, size_t pos) {
+bool ByteBuffer::putByte(uint8_t var, size_t pos) {
 	if(inRange(pos, 1)) {
 		buf[pos] = var;
 		return true;
@@ -166,11 +166,11 @@ bool ByteBuffer::putShort(uint16_t var) {
 bool ByteBuffer::putShort(uint16_t var, size_t pos) {
 	if (inRange(pos, 2)) {
 		if (this->byteOrder == BO_BIG_ENDIAN) {
-			buf[pos + 0] = static_cast<uint16_t>((var >> 8) & 255);
-			buf[pos + 1] = static_cast<uint16_t>((var) & 255);
+			buf[pos + 0] = static_cast<uint8_t>((var >> 8) & 255);
+			buf[pos + 1] = static_cast<uint8_t>((var) & 255);
 		} else {
-			buf[pos + 1] = static_cast<uint16_t>((var >> 8) & 255);
-			buf[pos + 0] = static_cast<uint16_t>((var) & 255);
+			buf[pos + 1] = static_cast<uint8_t>((var >> 8) & 255);
+			buf[pos + 0] = static_cast<uint8_t>((var) & 255);
 		}
 		return true;
 	}
@@ -190,15 +190,15 @@ bool ByteBuffer::putInt(int var) {
 bool ByteBuffer::putInt(int var, size_t pos) {
 	if(inRange(pos, 4)) {
 		if(this->byteOrder == BO_BIG_ENDIAN) {
-			buf[pos + 0] = static_cast<uint16_t>((var >> 24) & 255);
-			buf[pos + 1] = static_cast<uint16_t>((var >> 16) & 255);
-			buf[pos + 2] = static_cast<uint16_t>((var >> 8) & 255);
-			buf[pos + 3] = static_cast<uint16_t>(var & 255);
+			buf[pos + 0] = static_cast<uint8_t>((var >> 24) & 255);
+			buf[pos + 1] = static_cast<uint8_t>((var >> 16) & 255);
+			buf[pos + 2] = static_cast<uint8_t>((var >> 8) & 255);
+			buf[pos + 3] = static_cast<uint8_t>(var & 255);
 		} else {
-			buf[pos + 3] = static_cast<uint16_t>((var >> 24) & 255);
-			buf[pos + 2] = static_cast<uint16_t>((var >> 16) & 255);
-			buf[pos + 1] = static_cast<uint16_t>((var >> 8) & 255);
-			buf[pos + 0] = static_cast<uint16_t>(var & 255);
+			buf[pos + 3] = static_cast<uint8_t>((var >> 24) & 255);
+			buf[pos + 2] = static_cast<uint8_t>((var >> 16) & 255);
+			buf[pos + 1] = static_cast<uint8_t>((var >> 8) & 255);
+			buf[pos + 0] = static_cast<uint8_t>(var & 255);
 		}
 		return true;
 	} else {
@@ -221,8 +221,8 @@ bool ByteBuffer::putString(string var, size_t pos) {
 	if (inRange(pos, var.length() * 2)) {
 		for (size_t i = 0; i < var.length(); ++i) {
 			theChar = static_cast<uint16_t>(charArr[i]);
-			buf[pos + 0] = static_cast<uint16_t>((theChar >> 8) & 255);
-			buf[pos + 1] = static_cast<uint16_t>(theChar & 255);
+			buf[pos + 0] = static_cast<uint8_t>((theChar >> 8) & 255);
+			buf[pos + 1] = static_cast<uint8_t>(theChar & 255);
 			pos += 2;
 		}
 		return true;
@@ -244,11 +244,11 @@ bool ByteBuffer::putChar(char var, size_t pos) {
 	int tmp = var;
 	if(inRange(pos, 2)) {
 		if(byteOrder == BO_BIG_ENDIAN) {
-			buf[pos + 0] = static_cast<uint16_t>((tmp >> 8) & 255);
-			buf[pos + 1] = static_cast<uint16_t>(tmp & 255);
+			buf[pos + 0] = static_cast<uint8_t>((tmp >> 8) & 255);
+			buf[pos + 1] = static_cast<uint8_t>(tmp & 255);
 		} else {
-			buf[pos + 1] = static_cast<uint16_t>((tmp >> 8) & 255);
-			buf[pos + 0] = static_cast<uint16_t>(tmp & 255);
+			buf[pos + 1] = static_cast<uint8_t>((tmp >> 8) & 255);
+			buf[pos + 0] = static_cast<uint8_t>(tmp & 255);
 		}
 		return true;
 	} else {
@@ -267,7 +267,7 @@ bool ByteBuffer::putCharAscii(char var) {
 
 bool ByteBuffer::putCharAscii(char var, size_t pos) {
 	if(inRange(pos)) {
-		buf[pos] = static_cast<uint16_t>(var);
+		buf[pos] = static_cast<uint8_t>(var);
 		return true;
 	} else {
 		error();
@@ -287,7 +287,7 @@ bool ByteBuffer::putStringAscii(string var, size_t pos) {
 	const char* charArr = reinterpret_cast<const char*>(var.c_str());
 	if(inRange(pos, var.length())) {
 		for(size_t i = 0; i < var.length(); ++i) {
-			buf[pos] = static_cast<uint16_t>(charArr[i]);
+			buf[pos] = static_cast<uint8_t>(charArr[i]);
 			++pos;
 		}
 		return true;
@@ -297,7 +297,7 @@ bool ByteBuffer::putStringAscii(string var, size_t pos) {
 	}
 }
 
-bool ByteBuffer::putByteArray(vector<uint16_t>* arr) {
+bool ByteBuffer::putByteArray(vector<uint8_t>* arr) {
 	if (arr == nullptr) {
 		return false;
 	}
@@ -312,16 +312,14 @@ bool ByteBuffer::putByteArray(vector<uint16_t>* arr) {
 	return true;
 }
 
-bool ByteBuffer::readByteArray(vector<uint16_t>* arr) {
+bool ByteBuffer::readByteArray(vector<uint8_t>* arr) {
 	if(arr == nullptr) {
 		return false;
 	}
 	if(buf.size() - curPos < arr->size()) {
 		return false;
 	}
-	for(size_t i = 0; i < arr->size(); ++i) {
-		(*arr)[i] = static_cast<uint16_t>(buf[curPos + i] & 0xFF);
-	}
+	std::copy_n(buf.begin() + curPos, arr->size(), arr->begin());
 	curPos += arr->size();
 	return true;
 }
@@ -335,14 +333,14 @@ bool ByteBuffer::putShortArray(vector<uint16_t>* arr) {
 	}
 	if(byteOrder == BO_BIG_ENDIAN) {
 		for(size_t i = 0; i < arr->size(); ++i) {
-			buf[curPos + 0] = static_cast<uint16_t>(((*arr)[i] >> 8) & 255);
-			buf[curPos + 1] = static_cast<uint16_t>(((*arr)[i]) & 255);
+			buf[curPos + 0] = static_cast<uint8_t>(((*arr)[i] >> 8) & 255);
+			buf[curPos + 1] = static_cast<uint8_t>(((*arr)[i]) & 255);
 			curPos += 2;
 		}
 	} else {
 		for(size_t i = 0; i < arr->size(); ++i) {
-			buf[curPos + 1] = static_cast<uint16_t>(((*arr)[i] >> 8) & 255);
-			buf[curPos + 0] = static_cast<uint16_t>(((*arr)[i]) & 255);
+			buf[curPos + 1] = static_cast<uint8_t>(((*arr)[i] >> 8) & 255);
+			buf[curPos + 0] = static_cast<uint8_t>(((*arr)[i]) & 255);
 			curPos += 2;
 		}
 	}
@@ -377,13 +375,13 @@ bool ByteBuffer::readBoolean(size_t pos) {
 	return readByte(pos) == 1;
 }
 
-uint16_t ByteBuffer::readByte() {
-	uint16_t ret = readByte(curPos);
+uint8_t ByteBuffer::readByte() {
+	uint8_t ret = readByte(curPos);
 	move(1);
 	return ret;
 }
 
-uint16_t ByteBuffer::readByte(size_t pos) {
+uint8_t ByteBuffer::readByte(size_t pos) {
 	if(inRange(pos)) {
 		return buf[pos];
 	} else {
@@ -14,31 +14,33 @@ instructions and invokes emulation of the PPU and pAPU.
 
 #include "SaltyNES.h"
 
+// The fused opcode handlers rely on these being inlined, so the switches
+// on their constant arguments fold away:
+#if defined(CPU_DISPATCH_TABLE) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_INLINE inline __attribute__((always_inline))
+#else
+#define CPU_INLINE
+#endif
+
 CPU::CPU() : enable_shared_from_this<CPU>() {
 }
 
 shared_ptr<CPU> CPU::Init(shared_ptr<NES> nes) {
   this->nes = nes;
   this->mmap = nullptr;
+  this->ppu = nullptr;
+  this->papu = nullptr;
   this->mem = nullptr;
 
   // CPU Registers:
-  this->REG_ACC_NEW = 0;
-  this->REG_X_NEW = 0;
-  this->REG_Y_NEW = 0;
-  this->REG_STATUS_NEW = 0;
-  this->REG_PC_NEW = 0;
+  this->REG_ACC = 0;
+  this->REG_X = 0;
+  this->REG_Y = 0;
+  this->REG_PC = 0;
   this->REG_SP = 0;
 
   // Status flags:
-  this->F_CARRY_NEW = 0;
-  this->F_ZERO_NEW = 0;
-  this->F_INTERRUPT_NEW = 0;
-  this->F_DECIMAL_NEW = 0;
-  this->F_BRK_NEW = 0;
-  this->F_NOTUSED_NEW = 0;
-  this->F_OVERFLOW_NEW = 0;
-  this->F_SIGN_NEW = 0;
+  setStatus(0);
 
   // Interrupt notification:
   this->irqRequested = false;
@@ -48,28 +50,48 @@ shared_ptr<CPU> CPU::Init(shared_ptr<NES> nes) {
   this->cyclesToHalt = 0;
   this->stopRunning = false;
   this->crash = false;
+
+  // Throughput counters:
+  this->totalInstructions = 0;
+  this->idleSkips = 0;
+  this->idleSkippedInstructions = 0;
+  this->idleSkippedCycles = 0;
+
+  this->decoded = false;
+  this->decodedOperand = 0;
+  this->ioAccessed = false;
+  this->traceRuns = 0;
+  this->tracedInstructions = 0;
   return shared_from_this();
 }
 
 CPU::~CPU() {
   nes   = nullptr;
   mmap  = nullptr;
+  ppu   = nullptr;
+  papu  = nullptr;
 }
 
 // Initialize:
 void CPU::init() {
-  CpuInfo::initOpData();
+  // Get Memory Mapper and the other units:
+  this->mmap = nes->memMapper.get();
+  this->ppu = nes->ppu.get();
+  this->papu = nes->papu.get();
 
-  // Get Memory Mapper:
-  this->mmap = nes->getMemoryMapper();
+  // NES Memory
+  // (when memory mappers switch ROM banks
+  // this will be written to, no need to
+  // update reference):
+  this->mem = &nes->cpuMem->mem;
 
   // Reset crash flag:
   crash = false;
 
   // Set flags:
-  F_BRK_NEW = 1;
-  F_NOTUSED_NEW = 1;
-  F_INTERRUPT_NEW = 1;
+  F_BRK = 1;
+  F_NOTUSED = 1;
+  F_INTERRUPT = 1;
   irqRequested = false;
 }
 
@@ -78,38 +100,41 @@ void CPU::stateLoad(ByteBuffer* buf) {
     // Version 1
     // Registers:
     setStatus(buf->readInt());
-    REG_ACC_NEW = buf->readInt();
-    REG_PC_NEW  = buf->readInt();
-    REG_SP      = buf->readInt();
-    REG_X_NEW   = buf->readInt();
-    REG_Y_NEW   = buf->readInt();
+    REG_ACC = buf->readInt();
+    REG_PC  = buf->readInt();
+    REG_SP  = buf->readInt();
+    REG_X   = buf->readInt();
+    REG_Y   = buf->readInt();
 
     // Cycles to halt:
     cyclesToHalt = buf->readInt();
   }
+
+  // The CPU memory was replaced:
+  trace.clear();
 }
 
 void CPU::stateSave(ByteBuffer* buf) {
 
   // Save info version:
-  buf->putByte(static_cast<uint16_t>(1));
+  buf->putByte(static_cast<uint8_t>(1));
 
   // Save registers:
   buf->putInt(getStatus());
-  buf->putInt(REG_ACC_NEW);
-  buf->putInt(REG_PC_NEW );
-  buf->putInt(REG_SP     );
-  buf->putInt(REG_X_NEW  );
-  buf->putInt(REG_Y_NEW  );
+  buf->putInt(REG_ACC);
+  buf->putInt(REG_PC );
+  buf->putInt(REG_SP );
+  buf->putInt(REG_X  );
+  buf->putInt(REG_Y  );
 
   // Cycles to halt:
   buf->putInt(cyclesToHalt);
 }
 
 void CPU::reset() {
-  REG_ACC_NEW = 0;
-  REG_X_NEW = 0;
-  REG_Y_NEW = 0;
+  REG_ACC = 0;
+  REG_X = 0;
+  REG_Y = 0;
 
   irqRequested = false;
   irqType = 0;
@@ -118,49 +143,34 @@ void CPU::reset() {
   REG_SP = 0x01FF;
 
   // Reset Program counter:
-  REG_PC_NEW = 0x8000-1;
+  REG_PC = 0x8000-1;
 
   // Reset Status register:
-  REG_STATUS_NEW = 0x28;
   setStatus(0x28);
 
   // Reset crash flag:
   crash = false;
 
   // Set flags:
-  F_CARRY_NEW = 0;
-  F_DECIMAL_NEW = 0;
-  F_INTERRUPT_NEW = 1;
-  F_OVERFLOW_NEW = 0;
-  F_SIGN_NEW = 0;
-  F_ZERO_NEW = 0;
+  F_CARRY = 0;
+  F_DECIMAL = 0;
+  F_INTERRUPT = 1;
+  F_OVERFLOW = 0;
+  F_SIGN = 0;
+  F_ZERO = 1; // Zero flag clear
 
-  F_NOTUSED_NEW = 1;
-  F_BRK_NEW = 1;
+  F_NOTUSED = 1;
+  F_BRK = 1;
 
   cyclesToHalt = 0;
+  trace.clear();
 }
 
+// The registers are kept live between stop() and start(),
+// only the scratch state is cleared:
 void CPU::start() {
   stopRunning = false;
 
-  // Registers:
-  REG_ACC   = REG_ACC_NEW;
-  REG_X     = REG_X_NEW;
-  REG_Y     = REG_Y_NEW;
-  REG_STATUS  = REG_STATUS_NEW;
-  REG_PC    = REG_PC_NEW;
-
-  // Status flags:
-  F_CARRY   = F_CARRY_NEW;
-  F_ZERO  = (F_ZERO_NEW == 0);
-  F_INTERRUPT = F_INTERRUPT_NEW;
-  F_DECIMAL   = F_DECIMAL_NEW;
-  F_NOTUSED   = F_NOTUSED_NEW;
-  F_BRK   = F_BRK_NEW;
-  F_OVERFLOW  = F_OVERFLOW_NEW;
-  F_SIGN  = F_SIGN_NEW;
-
   // Misc. variables
   opinf = 0;
   opaddr = 0;
@@ -175,27 +185,192 @@ void CPU::start() {
 
 void CPU::stop() {
   stopRunning = true;
-
-  // Save registers:
-  REG_ACC_NEW   = REG_ACC;
-  REG_X_NEW   = REG_X;
-  REG_Y_NEW   = REG_Y;
-  REG_STATUS_NEW  = REG_STATUS;
-  REG_PC_NEW  = REG_PC;
-
-  // Save Status flags:
-  F_CARRY_NEW   = F_CARRY;
-  F_ZERO_NEW  = (F_ZERO==0?1:0);
-  F_INTERRUPT_NEW = F_INTERRUPT;
-  F_DECIMAL_NEW   = F_DECIMAL;
-  F_BRK_NEW   = F_BRK;
-  F_NOTUSED_NEW   = F_NOTUSED;
-  F_OVERFLOW_NEW  = F_OVERFLOW;
-  F_SIGN_NEW  = F_SIGN;
 }
 
+// Emulates cpu instructions until the screen is drawn.
+// The PPU is not stepped after every instruction. It is only caught up
+// when it reaches its next event (end of scanline, vblank NMI), or when
+// the CPU touches PPU visible state (see load and write).
+// The pAPU is still clocked per instruction, its mixer expects small steps.
+// With Globals::traceCache, PRG-ROM code runs a trace at a time, up to
+// the first of its instructions that can reach the next PPU event.
 void CPU::emulate_frame() {
-  while (!emulate()) {
+  const bool use_traces = Globals::traceCache && !Globals::palEmulation;
+  while (!nes->_is_paused) {
+    // Check interrupts:
+    handle_irq();
+
+    const TraceCache::Trace* t = nullptr;
+    int length = 0;
+    if (use_traces && REG_PC + 1 >= TraceCache::BASE) {
+      t = trace.lookup(REG_PC + 1, mmap);
+    }
+    if (t != nullptr) {
+      // Like single steps, only the last instruction may reach the event:
+      const int budget = (ppu->nextEventCycles - ppu->cycles - 1) / 3;
+      length = (t->maxCycles() <= budget) ? t->length : t->fit(budget) + 1;
+    }
+    if (length > 0) {
+      if (not run_trace(*t, length)) {
+        continue;
+      }
+    } else if (not step_inst()) {
+      continue;
+    }
+
+    if (Globals::palEmulation) {
+      ++palCnt;
+      if (palCnt == 5) {
+        palCnt = 0;
+        ++cycleCount;
+      }
+    }
+
+    ppu->cycles += cycleCount * 3;
+    bool did_render = false;
+    if (ppu->cycles >= ppu->nextEventCycles) {
+      did_render = ppu->emulateCycles();
+    }
+
+    if (Globals::enableSound) {
+      papu->clockFrameCounter(cycleCount);
+    }
+
+    if (did_render) {
+      return;
+    }
+
+    // Jumped back over a single instruction, maybe a polling loop:
+    const int back = opaddr - REG_PC;
+    if ((back == 2 || back == 3) && Globals::idleSkip && !Globals::palEmulation) {
+      skip_idle_loop();
+    }
+  }
+}
+
+// Skips a polling loop: a load of RAM or $2002 and a branch back to it,
+// like "BIT $2002 / BPL" or "CMP frame / BEQ". Once another iteration
+// would leave every register as it is, iterations are skipped until just
+// before the next PPU event, a sprite 0 hit or an IRQ. The pAPU is still
+// clocked per instruction, so the audio does not change.
+void CPU::skip_idle_loop() {
+  const int head = REG_PC + 1;
+  const int branch = opaddr + 1;
+  if (head < 0x6000 || branch > 0xFFFE) {
+    return;
+  }
+
+  // Match the load:
+  const int load_info = CpuInfo::opdata[mmap->load(head)];
+  const int inst = load_info & 0xFF;
+  const int addr_mode = (load_info >> 8) & 0xFF;
+  switch (inst) {
+    case CpuInfo::INS_LDA: case CpuInfo::INS_LDX: case CpuInfo::INS_LDY:
+    case CpuInfo::INS_BIT: case CpuInfo::INS_CMP: case CpuInfo::INS_CPX:
+    case CpuInfo::INS_CPY: case CpuInfo::INS_AND: case CpuInfo::INS_ORA:
+      break;
+    default:
+      return;
+  }
+  if (addr_mode != CpuInfo::ADDR_ZP && addr_mode != CpuInfo::ADDR_ABS) {
+    return;
+  }
+  if (head + ((load_info >> 16) & 0xFF) != branch) {
+    return;
+  }
+  int poll_addr = mmap->load(head + 1);
+  if (addr_mode == CpuInfo::ADDR_ABS) {
+    poll_addr |= mmap->load(head + 2) << 8;
+  }
+  if (poll_addr >= 0x2000 && poll_addr != 0x2002) {
+    return;
+  }
+
+  // Match the branch back:
+  const int branch_inst = CpuInfo::opdata[mmap->load(branch)] & 0xFF;
+  switch (branch_inst) {
+    case CpuInfo::INS_BCC: case CpuInfo::INS_BCS: case CpuInfo::INS_BEQ:
+    case CpuInfo::INS_BMI: case CpuInfo::INS_BNE: case CpuInfo::INS_BPL:
+    case CpuInfo::INS_BVC: case CpuInfo::INS_BVS:
+      break;
+    default:
+      return;
+  }
+
+  // Reading $2002 is only free of side effects while VBlank and the
+  // address latch are clear. It changes at the sprite 0 hit, so reads
+  // must not see that many PPU cycles:
+  ppu->catchUp();
+  if (ppu->spr0CheckPending && ppu->scanline - 21 == ppu->spr0CheckScan) {
+    ppu->checkSprite0(ppu->spr0CheckScan);
+  }
+  int read_limit = ppu->nextEventCycles;
+  if (poll_addr == 0x2002) {
+    if (!ppu->firstWrite || ((*mem)[0x2002] & 0x80) != 0) {
+      return;
+    }
+    if (ppu->scanline - 21 == ppu->spr0HitY && ppu->f_spVisibility == 1 &&
+        ppu->curX <= ppu->spr0HitX) {
+      read_limit = ppu->spr0HitX - ppu->curX;
+    }
+  }
+
+  // Run the load once more and check that nothing changes:
+  const uint32_t state =
+      REG_ACC | (REG_X << 8) | (REG_Y << 16) | (static_cast<uint32_t>(status_reg()) << 24);
+  const int saved_opaddr = opaddr;
+  const int saved_addr = addr;
+  const int saved_temp = temp;
+  const int saved_add = add;
+  const int branch_cycles = cycleCount;
+  opaddr = head - 1;
+  decoded = false;
+  cycleAdd = 0;
+  addr = calculate_addr(addr_mode);
+  exec_inst(inst, addr_mode);
+  const bool is_idle =
+      (REG_ACC | (REG_X << 8) | (REG_Y << 16) | (static_cast<uint32_t>(status_reg()) << 24)) == state;
+  REG_ACC = state & 0xFF;
+  REG_X = (state >> 8) & 0xFF;
+  REG_Y = (state >> 16) & 0xFF;
+  status_reg(state >> 24);
+  opaddr = saved_opaddr;
+  addr = saved_addr;
+  temp = saved_temp;
+  add = saved_add;
+  cycleCount = branch_cycles;
+  if (not is_idle) {
+    return;
+  }
+
+  // Skip whole instructions, leaving the one that reaches an event to
+  // the interpreter:
+  const int load_cycles = (load_info >> 24) & 0xFF;
+  ++idleSkips;
+  while (!irqRequested) {
+    if (ppu->cycles > read_limit || ppu->cycles + load_cycles * 3 >= ppu->nextEventCycles) {
+      break;
+    }
+    ppu->cycles += load_cycles * 3;
+    if (Globals::enableSound) {
+      papu->clockFrameCounter(load_cycles);
+    }
+    REG_PC = branch - 1;
+    ++totalInstructions;
+    ++idleSkippedInstructions;
+    idleSkippedCycles += load_cycles;
+    if (irqRequested || ppu->cycles + branch_cycles * 3 >= ppu->nextEventCycles) {
+      break;
+    }
+
+    ppu->cycles += branch_cycles * 3;
+    if (Globals::enableSound) {
+      papu->clockFrameCounter(branch_cycles);
+    }
+    REG_PC = head - 1;
+    ++totalInstructions;
+    ++idleSkippedInstructions;
+    idleSkippedCycles += branch_cycles;
   }
 }
 
@@ -205,9 +380,6 @@ void CPU::handle_irq() {
 
   const int tempx = status_reg();
 
-  REG_PC_NEW = REG_PC;
-  F_INTERRUPT_NEW = F_INTERRUPT;
-
   switch(irqType) {
     case 0: { // Normal IRQ:
       if (F_INTERRUPT != 0) {
@@ -231,21 +403,27 @@ void CPU::handle_irq() {
     }
   }
 
-  REG_PC = REG_PC_NEW;
-  F_INTERRUPT = F_INTERRUPT_NEW;
-  F_BRK = F_BRK_NEW;
   irqRequested = false;
 }
 
-int CPU::calculate_addr(const int addr_mode) {
+// Operand bytes of the current instruction:
+CPU_INLINE int CPU::operand8() {
+  return decoded ? decodedOperand : load(opaddr + 2);
+}
+
+CPU_INLINE int CPU::operand16() {
+  return decoded ? decodedOperand : load16bit(opaddr + 2);
+}
+
+CPU_INLINE int CPU::calculate_addr(const int addr_mode) {
   switch(addr_mode) {
     case 0: { // ZERO page mode
       // Use the address given after the opcode, but without high byte.
-      addr = load(opaddr + 2);
+      addr = operand8();
       break;
     }
     case 1: { // Relative mode.
-      addr = load(opaddr + 2);
+      addr = operand8();
       addr += (REG_PC - 256 * (addr >= 0x80));
       break;
     }
@@ -253,7 +431,7 @@ int CPU::calculate_addr(const int addr_mode) {
       break;
     }
     case 3: { // Absolute mode. Use the two bytes following the opcode as an address.
-      addr = load16bit(opaddr + 2);
+      addr = operand16();
       break;
     }
     case 4: { // Accumulator mode. The address is in the accumulator register.
@@ -267,25 +445,25 @@ int CPU::calculate_addr(const int addr_mode) {
     case 6: {
       // Zero Page Indexed mode, X as index. Use the address given after the opcode, then add the
       // X register to it to get the final address.
-      addr = (load(opaddr + 2) + REG_X) & 0xFF;
+      addr = (operand8() + REG_X) & 0xFF;
       break;
     }
     case 7: {
       // Zero Page Indexed mode, Y as index. Use the address given after the opcode, then add the
       // Y register to it to get the final address.
-      addr = (load(opaddr + 2) + REG_Y) & 0xFF;
+      addr = (operand8() + REG_Y) & 0xFF;
       break;
     }
     case 8: {
       // Absolute Indexed Mode, X as index. Same as zero page indexed, but with the high byte.
-      addr = load16bit(opaddr + 2);
+      addr = operand16();
       cycleAdd = ((addr & 0xFF00) != ((addr + REG_X) & 0xFF00));
       addr += REG_X;
       break;
     }
     case 9: {
       // Absolute Indexed Mode, Y as index. Same as zero page indexed, but with the high byte.
-      addr = load16bit(opaddr + 2);
+      addr = operand16();
       cycleAdd = ((addr & 0xFF00) != ((addr + REG_Y) & 0xFF00));
       addr += REG_Y;
       break;
@@ -293,7 +471,7 @@ int CPU::calculate_addr(const int addr_mode) {
     case 10: {
       // Pre-indexed Indirect mode. Find the 16-bit address starting at the given location plus
       // the current X register. The value is the contents of that address.
-      addr = load(opaddr + 2);
+      addr = operand8();
       cycleAdd = ((addr & 0xFF00) != ((addr + REG_X) & 0xFF00));
       addr = ((addr + REG_X) & 0xFF);
       addr = load16bit(addr);
@@ -304,14 +482,14 @@ int CPU::calculate_addr(const int addr_mode) {
       // Post-indexed Indirect mode. Find the 16-bit address contained in the given location
       // (and the one following). Add to that address the contents of the Y register. Fetch the value
       // stored at that adress.
-      addr = load16bit(load(opaddr + 2));
+      addr = load16bit(operand8());
       cycleAdd = ((addr & 0xFF00) != ((addr + REG_Y) & 0xFF00));
       addr += REG_Y;
       break;
     }
     case 12: {
       // Indirect Absolute mode. Find the 16-bit address contained at the given location.
-      addr = load16bit(opaddr + 2); // Find op
+      addr = operand16(); // Find op
       const int offset = (addr & 0xFF00) | (((addr & 0xFF) + 1) & 0xFF);
       if (addr < 0x1FFF) {
         addr = (*mem)[addr] + ((*mem)[offset] << 8);// Read from address given in op
@@ -329,8 +507,12 @@ int CPU::calculate_addr(const int addr_mode) {
   return addr;
 }
 
-bool CPU::exec_inst() {
-  switch (opinf & 0xFF) {
+CPU_INLINE bool CPU::exec_inst(const int inst, const int addr_mode) {
+  // Only the indexed address modes can cross a page:
+  const int page_cross =
+      (addr_mode >= CpuInfo::ADDR_ABSX && addr_mode <= CpuInfo::ADDR_POSTIDXIND) ? cycleAdd : 0;
+
+  switch (inst) {
     case 0: { // ADC
       // Add with carry.
       temp = REG_ACC + load(addr) + F_CARRY;
@@ -338,7 +520,7 @@ bool CPU::exec_inst() {
       F_CARRY = (temp > 255);
       F_SIGN = (temp >> 7) & 1;
       F_ZERO = REG_ACC = (temp & 0xFF);
-      cycleCount += cycleAdd;
+      cycleCount += page_cross;
       break;
     }
     case 1: { // AND
@@ -346,12 +528,12 @@ bool CPU::exec_inst() {
       REG_ACC = REG_ACC & load(addr);
       F_SIGN = (REG_ACC >> 7) & 1;
       F_ZERO = REG_ACC;
-      cycleCount += (cycleAdd * (addrMode != 11)); // PostIdxInd = 11
+      cycleCount += (page_cross * (addr_mode != 11)); // PostIdxInd = 11
       break;
     }
     case 2: { // * ASL *
       // Shift left one bit
-      if (addrMode == 4) { // ADDR_ACC = 4
+      if (addr_mode == 4) { // ADDR_ACC = 4
         F_CARRY = IS_SET(REG_ACC, 7); // (REG_ACC>>7)&1;
         REG_ACC = (REG_ACC << 1) & 0xff;
         F_SIGN = IS_SET(REG_ACC, 7); // (REG_ACC>>7)&1;
@@ -474,7 +656,7 @@ bool CPU::exec_inst() {
       F_CARRY = (temp >= 0);
       F_SIGN = (temp >> 7) & 1;
       F_ZERO = temp & 0xFF;
-      cycleCount += cycleAdd;
+      cycleCount += page_cross;
       break;
     }
     case 18: {  // * CPX *
@@ -519,7 +701,7 @@ bool CPU::exec_inst() {
       REG_ACC = (load(addr) ^ REG_ACC) & 0xFF;
       F_SIGN = (REG_ACC >> 7) & 1;
       F_ZERO = REG_ACC;
-      cycleCount += cycleAdd;
+      cycleCount += page_cross;
       break;
     }
     case 24: {  // * INC *
@@ -560,26 +742,26 @@ bool CPU::exec_inst() {
       // Load accumulator with memory:
       F_ZERO = REG_ACC = load(addr);
       F_SIGN = (REG_ACC >> 7) & 1;
-      cycleCount += cycleAdd;
+      cycleCount += page_cross;
       break;
     }
     case 30: {  // * LDX *
       // Load index X with memory:
       F_ZERO = REG_X = load(addr);
       F_SIGN = (REG_X >> 7) & 1;
-      cycleCount += cycleAdd;
+      cycleCount += page_cross;
       break;
     }
     case 31: {  // * LDY *
       // Load index Y with memory:
       F_ZERO = REG_Y = load(addr);
       F_SIGN = (REG_Y >> 7) & 1;
-      cycleCount += cycleAdd;
+      cycleCount += page_cross;
       break;
     }
     case 32: {  // * LSR *
       // Shift right one bit:
-      if (addrMode == 4) { // ADDR_ACC
+      if (addr_mode == 4) { // ADDR_ACC
         temp = (REG_ACC & 0xFF);
         F_CARRY = temp & 1;
         temp >>= 1;
@@ -601,7 +783,7 @@ bool CPU::exec_inst() {
       // OR memory with accumulator, store in accumulator.
       REG_ACC = F_ZERO = temp = (load(addr) | REG_ACC) & 255;
       F_SIGN = (temp >> 7) & 1;
-      cycleCount += cycleAdd * (addrMode != 11); // PostIdxInd = 11
+      cycleCount += page_cross * (addr_mode != 11); // PostIdxInd = 11
       break;
     }
     case 35: {  // * PHA *
@@ -630,7 +812,7 @@ bool CPU::exec_inst() {
     }
     case 39: {  // * ROL *
       // Rotate one bit left
-      if (addrMode == 4) { // ADDR_ACC = 4
+      if (addr_mode == 4) { // ADDR_ACC = 4
         temp = REG_ACC;
         add = F_CARRY;
         F_CARRY = IS_SET(temp, 7); //(temp>>7)&1;
@@ -650,7 +832,7 @@ bool CPU::exec_inst() {
     }
     case 40: {  // * ROR *
       // Rotate one bit right
-      if (addrMode == 4) { // ADDR_ACC = 4
+      if (addr_mode == 4) { // ADDR_ACC = 4
         add = F_CARRY << 7;
         F_CARRY = IS_SET(REG_ACC, 1);// & 1;
         temp = (REG_ACC >> 1) + add;
@@ -693,7 +875,7 @@ bool CPU::exec_inst() {
       REG_ACC = F_ZERO = temp & 0xFF;
       F_OVERFLOW = ((((REG_ACC^temp)&0x80)!=0 && ((REG_ACC^load(addr))&0x80)!=0)?1:0);
       F_CARRY = (temp >= 0);
-      cycleCount += cycleAdd * (addrMode != 11); // PostIdxInd = 11
+      cycleCount += page_cross * (addr_mode != 11); // PostIdxInd = 11
       break;
     }
     case 44: { // * SEC *
@@ -779,27 +961,74 @@ bool CPU::exec_inst() {
   return true;
 }
 
-// Emulates cpu instructions until screen is drawn.
-bool CPU::emulate() {
-  // NES Memory
-  // (when memory mappers switch ROM banks
-  // this will be written to, no need to
-  // update reference):
-  mem = &nes->cpuMem->mem;
+#ifdef CPU_DISPATCH_TABLE
+// Fetches and executes an opcode. Its size, cycles, address mode and
+// instruction are constants, so the switches and the page cross
+// checks of other address modes fold away:
+template <int OP>
+bool CPU::exec_op(CPU* cpu) {
+  constexpr int info = CpuInfo::opInfo(OP);
+  constexpr int inst = info & 0xFF;
+  constexpr int addr_mode = (info >> 8) & 0xFF;
+  constexpr int size = (info >> 16) & 0xFF;
+  constexpr int cycles = (info >> 24) & 0xFF;
+
+  cpu->cycleCount = cycles;
+  cpu->cycleAdd = 0;
+  cpu->opaddr = cpu->REG_PC;
+  cpu->REG_PC += size;
+  cpu->addr = cpu->calculate_addr(addr_mode);
+  return cpu->exec_inst(inst, addr_mode);
+}
+
+template <size_t... OPS>
+constexpr array<CPU::OpHandler, 256> CPU::make_op_handlers(index_sequence<OPS...>) {
+  return {{ &exec_op<OPS>... }};
+}
 
-  // References to other parts of NES:
-  shared_ptr<MapperDefault> mmap = nes->memMapper;
-  shared_ptr<PPU>      ppu  = nes->ppu;
-  shared_ptr<PAPU>     papu = nes->papu;
+const array<CPU::OpHandler, 256> CPU::op_handlers = make_op_handlers(make_index_sequence<256>());
+#endif
 
-  if (this->nes->_is_paused) {
+// Emulates a single instruction, and the PPU and pAPU after it.
+// Returns true if the screen was drawn.
+bool CPU::emulate() {
+  if (nes->_is_paused) {
     return false;
   }
 
   // Check interrupts:
   handle_irq();
 
-  const uint16_t z = mmap->load(REG_PC + 1);
+  if (not step_inst()) {
+    return false;
+  }
+
+  if (Globals::palEmulation) {
+    ++palCnt;
+    if (palCnt == 5) {
+      palCnt = 0;
+      ++cycleCount;
+    }
+  }
+
+  ppu->cycles += cycleCount * 3;
+  const bool did_render = ppu->emulateCycles();
+
+  if (Globals::enableSound) {
+    papu->clockFrameCounter(cycleCount);
+  }
+
+  return did_render;
+}
+
+// Executes an opcode whose operand is at REG_PC + 2, or in
+// decodedOperand while decoded is set.
+CPU_INLINE bool CPU::exec_opcode(const int z) {
+#ifdef CPU_DISPATCH_TABLE
+  if (not op_handlers[z](this)) {
+    return false;
+  }
+#else
   opinf = CpuInfo::opdata[z];
   cycleCount = (opinf >> 24);
   cycleAdd = 0;
@@ -818,43 +1047,80 @@ bool CPU::emulate() {
   // ----------------------------------------------------------------------------------------------------
   // Decode & execute instruction:
   // ----------------------------------------------------------------------------------------------------
-  if (not exec_inst()) {
+  if (not exec_inst(opinf & 0xFF, addrMode)) {
     return false;
   }
+#endif
+  ++totalInstructions;
+  return true;
+}
 
-  if (Globals::palEmulation) {
-    ++palCnt;
-    if (palCnt == 5) {
-      palCnt = 0;
-      ++cycleCount;
-    }
-  }
+// Fetches, decodes and executes one instruction.
+// Leaves the cycles it took in cycleCount.
+bool CPU::step_inst() {
+  return exec_opcode(load(REG_PC + 1));
+}
 
-  ppu->cycles = cycleCount * 3;
-  const bool did_render = ppu->emulateCycles();
+// Runs the first length instructions of a trace. The caller checked that
+// all but the last end before the next PPU event, so after each of those
+// the PPU only needs its cycles and the pAPU is clocked as usual. An I/O
+// access can swap banks or move the next event, so the trace stops after
+// one. It also stops when the pAPU requests an IRQ.
+// Returns true when the cycles of the last instruction are left in
+// cycleCount, like step_inst.
+bool CPU::run_trace(const TraceCache::Trace& t, const int length) {
+  ++traceRuns;
+  ioAccessed = false;
+  decoded = true;
+  for (int i = 0; ; ++i) {
+    decodedOperand = t.ops[i].operand;
+    if (not exec_opcode(t.ops[i].opcode)) {
+      break;
+    }
+    ++tracedInstructions;
+    if (ioAccessed || i + 1 == length) {
+      decoded = false;
+      return true;
+    }
 
-  if (Globals::enableSound) {
-    papu->clockFrameCounter(cycleCount);
+    ppu->cycles += cycleCount * 3;
+    if (Globals::enableSound) {
+      papu->clockFrameCounter(cycleCount);
+    }
+    if (irqRequested) {
+      break;
+    }
   }
-
-  return did_render;
+  decoded = false;
+  return false;
 }
 
 int CPU::load(int addr) {
-  return addr < 0x2000 ? (*mem)[addr & 0x7FF] : mmap->load(addr);
+  const uint8_t* page = mmap->readPage[(addr >> 8) & 0xFF];
+  if (page != nullptr) {
+    return page[addr & 0xFF];
+  }
+
+  // I/O registers see the PPU as of the previous instruction:
+  if (addr < 0x4018) {
+    ppu->catchUp();
+  }
+  ioAccessed = true;
+  return mmap->load(addr);
 }
 
 int CPU::load16bit(int addr) {
-  return
-      addr < 0x1FFF ?
-          (*mem)[addr & 0x7FF] | ((*mem)[(addr + 1) & 0x7FF] << 8) :
-          mmap->load(addr)     | (mmap->load(addr + 1) << 8);
+  return load(addr) | (load(addr + 1) << 8);
 }
 
 void CPU::write(int addr, uint16_t val) {
-  if (addr < 0x2000) {
-    (*mem)[addr & 0x7FF] = val;
+  uint8_t* page = mmap->writePage[(addr >> 8) & 0xFF];
+  if (page != nullptr) {
+    page[addr & 0xFF] = val;
   } else {
+    // Register and mapper writes can change what the PPU renders:
+    ppu->catchUp();
+    ioAccessed = true;
     mmap->write(addr, val);
   }
 }
@@ -897,53 +1163,38 @@ void CPU::doNonMaskableInterrupt(int status) {
   int temp = mmap->load(0x2000); // Read PPU status.
   if ((temp & 128) != 0) { // Check whether VBlank Interrupts are enabled
 
-    ++REG_PC_NEW;
-    push((REG_PC_NEW >> 8) & 0xFF);
-    push(REG_PC_NEW & 0xFF);
-    //F_INTERRUPT_NEW = 1;
+    ++REG_PC;
+    push((REG_PC >> 8) & 0xFF);
+    push(REG_PC & 0xFF);
+    //F_INTERRUPT = 1;
     push(status);
-    REG_PC_NEW = mmap->load(0xFFFA) | (mmap->load(0xFFFB) << 8);
-    --REG_PC_NEW;
+    REG_PC = mmap->load(0xFFFA) | (mmap->load(0xFFFB) << 8);
+    --REG_PC;
   }
 }
 
 void CPU::doResetInterrupt() {
-  REG_PC_NEW = mmap->load(0xFFFC) | (mmap->load(0xFFFD) << 8);
-  --REG_PC_NEW;
+  REG_PC = mmap->load(0xFFFC) | (mmap->load(0xFFFD) << 8);
+  --REG_PC;
 }
 
 void CPU::doIrq(int status) {
-  ++REG_PC_NEW;
-  push((REG_PC_NEW >> 8) & 0xFF);
-  push(REG_PC_NEW & 0xFF);
+  ++REG_PC;
+  push((REG_PC >> 8) & 0xFF);
+  push(REG_PC & 0xFF);
   push(status);
-  F_INTERRUPT_NEW = 1;
-  F_BRK_NEW = 0;
-  REG_PC_NEW = mmap->load(0xFFFE) | (mmap->load(0xFFFF) << 8);
-  --REG_PC_NEW;
+  F_INTERRUPT = 1;
+  F_BRK = 0;
+  REG_PC = mmap->load(0xFFFE) | (mmap->load(0xFFFF) << 8);
+  --REG_PC;
 }
 
 int CPU::getStatus() {
-  return
-      ((F_CARRY_NEW & 0x01)   | 
-       (F_ZERO_NEW      << 1) | 
-       (F_INTERRUPT_NEW << 2) |
-       (F_DECIMAL_NEW   << 3) |
-       (F_BRK_NEW       << 4) |
-       (F_NOTUSED_NEW   << 5) |
-       (F_OVERFLOW_NEW  << 6) |
-       (F_SIGN_NEW      << 7));
+  return status_reg();
 }
 
 void CPU::setStatus(int st) {
-  F_CARRY_NEW     = (st   )&1;
-  F_ZERO_NEW      = (st>>1)&1;
-  F_INTERRUPT_NEW = (st>>2)&1;
-  F_DECIMAL_NEW   = (st>>3)&1;
-  F_BRK_NEW       = (st>>4)&1;
-  F_NOTUSED_NEW   = (st>>5)&1;
-  F_OVERFLOW_NEW  = (st>>6)&1;
-  F_SIGN_NEW      = (st>>7)&1;
+  status_reg(st);
 }
 
 void CPU::setCrashed(bool value) {
@@ -951,5 +1202,5 @@ void CPU::setCrashed(bool value) {
 }
 
 void CPU::setMapper(shared_ptr<MapperDefault> mapper) {
-  mmap = mapper;
+  mmap = mapper.get();
 }
@@ -115,8 +115,8 @@ void ChannelDM::endOfSample() {
 
 void ChannelDM::nextSample() {
 	// Fetch byte:
-	data = papu->getNes()->getMemoryMapper()->load(playAddress);
-	papu->getNes()->cpu->haltCycles(4);
+	data = papu->nes->memMapper->load(playAddress);
+	papu->nes->cpu->haltCycles(4);
 
 	--playLengthCounter;
 	++playAddress;
@@ -11,6 +11,7 @@ Hosted at: https://github.com/workhorsy/SaltyNES
 SDL_Window*   Globals::g_window     = nullptr;
 SDL_Renderer* Globals::g_renderer   = nullptr;
 SDL_Texture*  Globals::g_screen     = nullptr;
+uint32_t      Globals::g_screen_format = SDL_PIXELFORMAT_BGR888;
 TTF_Font*     Globals::g_osd_font   = nullptr;
 SDL_Color*    Globals::g_osd_color  = nullptr;
 
@@ -30,8 +31,18 @@ bool Globals::disableSprites  = false;
 bool Globals::palEmulation    = false;
 bool Globals::enableSound     = true;
 bool Globals::printFps        = false;
+bool Globals::uncapped        = false;
+bool Globals::traceCache      = false;
+bool Globals::idleSkip        = true;
+bool Globals::simdBackground  = true;
+bool Globals::spriteLimit     = false;
+bool Globals::renderThread    = true;
 
 std::map<string, uint32_t> Globals::keycodes; //Java key codes
 std::map<string, string> Globals::controls; //vNES controls codes
 std::map<int, SDL_Joystick*> Globals::joysticks;
 bool Globals::is_windows = false;
+
+bool Globals::headless = false;
+IVideoSink* Globals::video_sink = nullptr;
+IAudioSink* Globals::audio_sink = nullptr;
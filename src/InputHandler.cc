@@ -23,7 +23,8 @@ InputHandler::~InputHandler() {
 }
 
 uint16_t InputHandler::getKeyState(int padKey) {
-  return static_cast<uint16_t>(_keys[_map[padKey]] ? 0x41 : 0x40);
+  const bool pressed = ((_pad_state.load(std::memory_order_relaxed) >> padKey) & 1) != 0;
+  return static_cast<uint16_t>(pressed ? 0x41 : 0x40);
 }
 
 void InputHandler::mapKey(int padKey, int kbKeycode) {
@@ -138,12 +139,22 @@ void InputHandler::poll_for_key_events() {
   } else if(_keys[_map[InputHandler::KEY_DOWN]]) {
     _keys[_map[InputHandler::KEY_UP]] = false;
   }
+
+  // Publish all the keys at once:
+  uint32_t pad_state = 0;
+  for (int key = 0; key < NUM_KEYS; ++key) {
+    if (_keys[_map[key]]) {
+      pad_state |= (1u << key);
+    }
+  }
+  _pad_state.store(pad_state, std::memory_order_relaxed);
 }
 
 void InputHandler::reset() {
   size_t size = _keys.size();
   _keys.clear();
   _keys.resize(size);
+  _pad_state.store(0, std::memory_order_relaxed);
 }
 
 void InputHandler::key_down(uint32_t key) {
@@ -38,7 +38,7 @@ void Mapper004::mapperInternalStateSave(ByteBuffer* buf) {
 	this->base_mapperInternalStateSave(buf);
 
 	// Version:
-	buf->putByte(static_cast<uint16_t>(1));
+	buf->putByte(static_cast<uint8_t>(1));
 
 	// State:
 	buf->putInt(command);
@@ -16,33 +16,10 @@ shared_ptr<MapperDefault> Mapper007::Init(shared_ptr<NES> nes) {
 	currentOffset = 0;
 	currentMirroring = -1;
 
-	// Get ref to ROM:
-	shared_ptr<ROM> rom = nes->getRom();
-
-	// Read out all PRG rom:
-	int bc = rom->getRomBankCount();
-	prgrom = vector<uint16_t>(bc * 16384, 0);
-	for(int i = 0; i < bc; ++i) {
-		array_copy(rom->getRomBank(i), 0, &prgrom, i * 16384, 16384);
-	}
-
 	this->base_init(nes);
 	return shared_from_this();
 }
 
-uint16_t Mapper007::load(int address) {
-	if(address < 0x8000) {
-		// Register read
-		return this->base_load(address);
-	} else {
-		if((address + currentOffset) >= 262144) {
-			return prgrom[(address + currentOffset) - 262144];
-		} else {
-			return prgrom[address + currentOffset];
-		}
-	}
-}
-
 void Mapper007::write(int address, uint16_t value) {
 	if(address < 0x8000) {
 		// Let the base mapper take care of it.
@@ -50,6 +27,7 @@ void Mapper007::write(int address, uint16_t value) {
 	} else {
 		// Set PRG offset:
 		currentOffset = ((value & 0xF) - 1) << 15;
+		loadPrgBank();
 
 		// Set mirroring:
 		if(currentMirroring != (value & 0x10)) {
@@ -72,6 +50,7 @@ void Mapper007::mapperInternalStateLoad(ByteBuffer* buf) {
 	if(buf->readByte() == 1) {
 		currentMirroring = buf->readByte();
 		currentOffset = buf->readInt();
+		loadPrgBank();
 	}
 }
 
@@ -79,10 +58,10 @@ void Mapper007::mapperInternalStateSave(ByteBuffer* buf) {
 	this->base_mapperInternalStateSave(buf);
 
 	// Version:
-	buf->putByte(static_cast<uint16_t>(1));
+	buf->putByte(static_cast<uint8_t>(1));
 
 	// State:
-	buf->putByte(static_cast<uint16_t>(currentMirroring));
+	buf->putByte(static_cast<uint8_t>(currentMirroring));
 	buf->putInt(currentOffset);
 }
 
@@ -91,3 +70,14 @@ void Mapper007::reset() {
 	currentOffset = 0;
 	currentMirroring = -1;
 }
+
+void Mapper007::loadROM(shared_ptr<ROM> rom) {
+	this->MapperDefault::loadROM(rom);
+	loadPrgBank();
+}
+
+// Maps the 32KB bank selected by currentOffset to $8000. Offsets wrap
+// around at 256KB.
+void Mapper007::loadPrgBank() {
+	load32kRomBank(((currentOffset >> 15) + 1) & 0x7, 0x8000);
+}
@@ -177,7 +177,7 @@ void Mapper009::mapperInternalStateSave(ByteBuffer* buf) {
 	this->base_mapperInternalStateSave(buf);
 
 	// Version:
-	buf->putByte(static_cast<uint16_t>(1));
+	buf->putByte(static_cast<uint8_t>(1));
 
 	// State:
 	buf->putByte(static_cast<uint8_t>(latchLo));
@@ -36,7 +36,7 @@ void Mapper198::mapperInternalStateSave(ByteBuffer* buf) {
 	this->base_mapperInternalStateSave(buf);
 
 	// Version:
-	buf->putByte(static_cast<uint16_t>(1));
+	buf->putByte(static_cast<uint8_t>(1));
 
 	// State:
 	buf->putInt(command);
@@ -40,6 +40,7 @@ MapperDefault::~MapperDefault() {
 	rom = nullptr;
 	cpu = nullptr;
 	ppu = nullptr;
+	papu = nullptr;
 }
 
 void MapperDefault::write(int address, uint16_t value) {
@@ -54,16 +55,30 @@ void MapperDefault::base_init(shared_ptr<NES> nes) {
 	this->rom = nes->getRom();
 	this->cpu = nes->getCpu();
 	this->ppu = nes->getPpu();
+	this->papu = nes->getPapu();
 
 	cpuMemSize = cpuMem->getMemSize();
 	joypadLastWrite = -1;
 
+	// RAM is mirrored every 2KB. The expansion area and SRAM are read
+	// straight from CPU memory, PRG-ROM is mapped by the bank loaders:
+	readPage.fill(nullptr);
+	writePage.fill(nullptr);
+	for(int page = 0; page < 0x20; ++page) {
+		writePage[page] = &cpuMem->mem[(page & 0x7) << 8];
+		readPage[page] = writePage[page];
+	}
+	mapReadPages(0x4100, 0x8000 - 0x4100, &cpuMem->mem[0x4100]);
 }
 
 void MapperDefault::stateLoad(ByteBuffer* buf) {
 	// Check version:
 	if(buf->readByte() == 1) {
 
+		// PRG-ROM was restored with CPU memory, read it from there
+		// until the next bank switch:
+		mapReadPages(0x8000, KB(32), &cpuMem->mem[0x8000]);
+
 		// Joypad stuff:
 		joy1StrobeState = buf->readInt();
 		joy2StrobeState = buf->readInt();
@@ -77,7 +92,7 @@ void MapperDefault::stateLoad(ByteBuffer* buf) {
 
 void MapperDefault::stateSave(ByteBuffer* buf) {
 	// Version:
-	buf->putByte(static_cast<uint16_t>(1));
+	buf->putByte(static_cast<uint8_t>(1));
 
 	// Joypad stuff:
 	buf->putInt(joy1StrobeState);
@@ -89,9 +104,9 @@ void MapperDefault::stateSave(ByteBuffer* buf) {
 }
 
 void MapperDefault::base_mapperInternalStateLoad(ByteBuffer* buf) {
-	buf->putByte(static_cast<uint16_t>(joy1StrobeState));
-	buf->putByte(static_cast<uint16_t>(joy2StrobeState));
-	buf->putByte(static_cast<uint16_t>(joypadLastWrite));
+	buf->putByte(static_cast<uint8_t>(joy1StrobeState));
+	buf->putByte(static_cast<uint8_t>(joy2StrobeState));
+	buf->putByte(static_cast<uint8_t>(joypadLastWrite));
 
 }
 
@@ -117,7 +132,10 @@ void MapperDefault::base_write(int address, uint16_t value) {
 
 	} else if(address > 0x4017) {
 
-		cpuMem->mem[address] = value;
+		// PRG-ROM is read only:
+		if(address < 0x8000) {
+			cpuMem->mem[address] = value;
+		}
 		if(address >= 0x6000 && address < 0x8000) {
 
 			// Write to SaveRAM. Store in file:
@@ -145,7 +163,10 @@ void MapperDefault::writelow(int address, uint16_t value) {
 		cpuMem->mem[address & 0x7FF] = value;
 
 	} else if(address > 0x4017) {
-		cpuMem->mem[address] = value;
+		// PRG-ROM is read only:
+		if(address < 0x8000) {
+			cpuMem->mem[address] = value;
+		}
 
 	} else if(address > 0x2007 && address < 0x4000) {
 		regWrite(0x2000 + (address & 0x7), value);
@@ -164,10 +185,16 @@ uint16_t MapperDefault::base_load(int address) {
 	// Wrap around:
 	address &= 0xFFFF;
 
+	// RAM, SRAM and ROM:
+	const uint8_t* page = readPage[address >> 8];
+	if(page != nullptr) {
+		return page[address & 0xFF];
+	}
+
 	// Check address range:
 	if(address > 0x4017) {
 
-		// ROM:
+		// Expansion area:
 		return (*cpuMemArray)[address];
 
 	} else if(address >= 0x2000) {
@@ -264,7 +291,7 @@ uint16_t MapperDefault::regLoad(int address) {
 
 					// 0x4015:
 					// Sound channel enable, DMC Status
-					return nes->getPapu()->readReg();
+					return papu->readReg();
 
 				}
 				case 1: {
@@ -380,7 +407,7 @@ void MapperDefault::regWrite(int address, uint16_t value) {
 		case 0x4015: {
 
 			// Sound Channel Switch, DMC Status
-			nes->getPapu()->writeReg(address, value);
+			papu->writeReg(address, value);
 			break;
 
 		}
@@ -401,7 +428,7 @@ void MapperDefault::regWrite(int address, uint16_t value) {
 		case 0x4017: {
 
 			// Sound channel frame sequencer:
-			nes->papu->writeReg(address, value);
+			papu->writeReg(address, value);
 			break;
 
 		}
@@ -410,7 +437,7 @@ void MapperDefault::regWrite(int address, uint16_t value) {
 			// Sound registers
 			////System.out.println("write to sound reg");
 			if(address >= 0x4000 && address <= 0x4017) {
-				nes->getPapu()->writeReg(address, value);
+				papu->writeReg(address, value);
 			}
 			break;
 
@@ -583,7 +610,7 @@ void MapperDefault::loadCHRROM() {
 
 void MapperDefault::loadBatteryRam() {
 	if(rom->batteryRam) {
-		array<uint16_t, 0x2000>* ram = rom->getBatteryRam();
+		array<uint8_t, 0x2000>* ram = rom->getBatteryRam();
 		if(ram != nullptr && ram->size() == 0x2000) {
 			array_copy(ram, 0, &nes->cpuMem->mem, 0x6000, 0x2000);
 		}
@@ -593,10 +620,7 @@ void MapperDefault::loadBatteryRam() {
 void MapperDefault::loadRomBank(int bank, int address) {
 	// Loads a ROM bank into the specified address.
 	bank %= rom->getRomBankCount();
-	//array<uint16_t, 16384>* data = rom->getRomBank(bank);
-	//cpuMem->write(address,data,data.length);
-	array_copy(rom->getRomBank(bank), 0, &cpuMem->mem, address, 16384);
-
+	mapReadPages(address, 16384, rom->getRomBank(bank)->data());
 }
 
 void MapperDefault::loadVromBank(int bank, int address) {
@@ -605,10 +629,8 @@ void MapperDefault::loadVromBank(int bank, int address) {
 	}
 	ppu->triggerRendering();
 
-	array_copy(rom->getVromBank(bank % rom->getVromBankCount()), 0, &nes->ppuMem->mem, address, 4096);
-
-	array<Tile, 256>* vromTile = rom->getVromBankTiles(bank % rom->getVromBankCount());
-	array_copy(vromTile, 0, &ppu->ptTile, address >> 4, 256);
+	bank %= rom->getVromBankCount();
+	ppu->mapChrBanks(address, 4096, rom->getVromBank(bank)->data(), rom->getVromBankTiles(bank)->data());
 }
 
 void MapperDefault::load32kRomBank(int bank, int address) {
@@ -634,14 +656,7 @@ void MapperDefault::load1kVromBank(int bank1k, int address) {
 
 	int bank4k = (bank1k / 4) % rom->getVromBankCount();
 	int bankoffset = (bank1k % 4) * 1024;
-	array_copy(rom->getVromBank(bank4k), 0, &nes->ppuMem->mem, bankoffset, 1024);
-
-	// Update tiles:
-	array<Tile, 256>* vromTile = rom->getVromBankTiles(bank4k);
-	int baseIndex = address >> 4;
-	for(int i = 0; i < 64; ++i) {
-		ppu->ptTile[baseIndex + i] = (*vromTile)[((bank1k % 4) << 6) + i];
-	}
+	ppu->mapChrBanks(address, 1024, rom->getVromBank(bank4k)->data() + bankoffset, rom->getVromBankTiles(bank4k)->data() + (bankoffset >> 4));
 }
 
 void MapperDefault::load2kVromBank(int bank2k, int address) {
@@ -653,20 +668,37 @@ void MapperDefault::load2kVromBank(int bank2k, int address) {
 
 	const int bank4k = (bank2k / 2) % rom->getVromBankCount();
 	const int bankoffset = (bank2k % 2) * KB(2);
-	array_copy(rom->getVromBank(bank4k), bankoffset, &nes->ppuMem->mem, address, KB(2));
-
-	// Update tiles:
-	auto vromTile = rom->getVromBankTiles(bank4k);
-	int baseIndex = address >> 4;
-	for (int i = 0; i < 128; ++i) {
-		ppu->ptTile[baseIndex + i] = (*vromTile)[((bank2k % 2) << 7) + i];
-	}
+	ppu->mapChrBanks(address, KB(2), rom->getVromBank(bank4k)->data() + bankoffset, rom->getVromBankTiles(bank4k)->data() + (bankoffset >> 4));
 }
 
 void MapperDefault::load8kRomBank(int bank8k, int address) {
 	const int bank16k = (bank8k / 2) % rom->getRomBankCount();
 	const int offset  = (bank8k & 0x01) * KB(8);
-	cpuMem->write(address, rom->getRomBank(bank16k), offset, KB(8));
+	mapReadPages(address, KB(8), rom->getRomBank(bank16k)->data() + offset);
+}
+
+// Points the CPU read pages of [address, address + length) at data.
+// Mapping the same bank again keeps its traces.
+void MapperDefault::mapReadPages(int address, int length, const uint8_t* data) {
+	bool changed = false;
+	for(int offset = 0; offset < length; offset += 0x100) {
+		const uint8_t*& page = readPage[(address + offset) >> 8];
+		changed = changed || page != data + offset;
+		page = data + offset;
+	}
+	if(changed) {
+		cpu->trace.invalidate(address, length);
+	}
+}
+
+// Save states keep PRG-ROM in CPU memory, so copy the mapped banks there.
+void MapperDefault::syncPrgMemory() {
+	for(int page = 0x80; page < 0x100; ++page) {
+		uint8_t* dest = &cpuMem->mem[page << 8];
+		if(readPage[page] != nullptr && readPage[page] != dest) {
+			std::copy(readPage[page], readPage[page] + 0x100, dest);
+		}
+	}
 }
 
 void MapperDefault::clockIrqCounter() {
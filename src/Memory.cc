@@ -14,7 +14,7 @@ Memory::Memory() : enable_shared_from_this<Memory>() {
 
 shared_ptr<Memory> Memory::Init(shared_ptr<NES> nes, size_t byteCount) {
 	this->nes = nes;
-	this->mem = vector<uint16_t>(byteCount, 0);
+	this->mem = vector<uint8_t>(byteCount, 0);
 	return shared_from_this();
 }
 
@@ -38,11 +38,11 @@ size_t Memory::getMemSize() {
 	return mem.size();
 }
 
-void Memory::write(size_t address, uint16_t value) {
+void Memory::write(size_t address, uint8_t value) {
 	mem[address] = value;
 }
 
-uint16_t Memory::load(size_t address) {
+uint8_t Memory::load(size_t address) {
 	return mem[address];
 }
 
@@ -67,13 +67,13 @@ void Memory::dump(string file, size_t offset, size_t length) {
 	}
 }
 
-void Memory::write(size_t address, array<uint16_t, 16384>* array, size_t length) {
+void Memory::write(size_t address, array<uint8_t, 16384>* array, size_t length) {
 	if(address+length > mem.size())
 		return;
 	array_copy(array, 0, &mem, address, length);
 }
 
-void Memory::write(size_t address, array<uint16_t, 16384>* array, size_t arrayoffset, size_t length) {
+void Memory::write(size_t address, array<uint8_t, 16384>* array, size_t arrayoffset, size_t length) {
 	if(address+length > mem.size())
 		return;
 	array_copy(array, arrayoffset, &mem, address, length);
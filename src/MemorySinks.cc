@@ -0,0 +1,43 @@
+/*
+Copyright (c) 2012-2017 Matthew Brennan Jones <matthew.brennan.jones@gmail.com>
+A NES emulator in WebAssembly. Based on vNES.
+Licensed under GPLV3 or later
+Hosted at: https://github.com/workhorsy/SaltyNES
+*/
+
+#include "SaltyNES.h"
+
+MemoryVideoSink::MemoryVideoSink() :
+    m_frame_count(0) {
+  m_frame.fill(0);
+}
+
+void MemoryVideoSink::on_frame(const array<int, RES_PIXEL>& screen) {
+  m_frame = screen;
+  ++m_frame_count;
+}
+
+/* FNV-1a over the last frame. Handy to compare runs of the same rom. */
+uint32_t MemoryVideoSink::checksum() const {
+  uint32_t hash = 2166136261u;
+  for (const int pixel : m_frame) {
+    hash = (hash ^ static_cast<uint32_t>(pixel)) * 16777619u;
+  }
+  return hash;
+}
+
+MemoryAudioSink::MemoryAudioSink(size_t capacity) :
+    m_capacity(capacity),
+    m_total_bytes(0) {
+  m_samples.reserve(capacity);
+}
+
+void MemoryAudioSink::on_samples(const uint8_t* data, size_t length) {
+  m_total_bytes += length;
+  m_samples.insert(m_samples.end(), data, data + length);
+
+  /* drop the oldest data once we are over capacity */
+  if (m_samples.size() > m_capacity) {
+    m_samples.erase(m_samples.begin(), m_samples.end() - m_capacity);
+  }
+}
@@ -80,7 +80,7 @@ float Misc::random() {
 	return rndret;
 }
 
-string Misc::from_vector_to_hex_string(array<uint16_t, 0x2000>* data) {
+string Misc::from_vector_to_hex_string(array<uint8_t, 0x2000>* data) {
 	const size_t BYTE_LEN = 4;
 	stringstream out;
 	for(size_t i=0; i<data->size(); ++i) {
@@ -89,10 +89,10 @@ string Misc::from_vector_to_hex_string(array<uint16_t, 0x2000>* data) {
 	return out.str();
 }
 
-vector<uint16_t>* Misc::from_hex_string_to_vector(string data) {
+vector<uint8_t>* Misc::from_hex_string_to_vector(string data) {
 	const size_t BYTE_LEN = 4;
 	const size_t VECTOR_SIZE = data.length() / BYTE_LEN;
-	vector<uint16_t>* retval = new vector<uint16_t>(VECTOR_SIZE, 0);
+	vector<uint8_t>* retval = new vector<uint8_t>(VECTOR_SIZE, 0);
 
 	uint16_t value = 0;
 	stringstream in;
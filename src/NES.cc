@@ -138,9 +138,11 @@ void NES::stateSave(ByteBuffer* buf) {
 	stopEmulation();
 
 	// Version:
-	buf->putByte(static_cast<uint16_t>(1));
+	buf->putByte(static_cast<uint8_t>(1));
 
 	// Let units save their state:
+	memMapper->syncPrgMemory();
+	ppu->syncChrMemory();
 	cpuMem->stateSave(buf);
 	ppuMem->stateSave(buf);
 	sprMem->stateSave(buf);
@@ -240,7 +242,7 @@ shared_ptr<MapperDefault> NES::getMemoryMapper() {
 	return memMapper;
 }
 
-bool NES::load_rom_from_data(string rom_name, vector<uint8_t>* data, array<uint16_t, 0x2000>* save_ram) {
+bool NES::load_rom_from_data(string rom_name, vector<uint8_t>* data, array<uint8_t, 0x2000>* save_ram) {
 	// Can't load ROM while still running.
 	if(_isRunning) {
 		stopEmulation();
@@ -212,6 +212,11 @@ shared_ptr<PAPU> PAPU::Init(shared_ptr<NES> nes) {
   frameIrqCounter = 0;
   frameIrqCounterMax = 4;
 
+  // Headless has no audio device, samples go to Globals::audio_sink
+  if (Globals::headless) {
+    return shared_from_this();
+  }
+
   // Setup SDL for the format we want
   SDL_AudioSpec desiredSpec;
   desiredSpec.freq = 44100;
@@ -266,7 +271,9 @@ void PAPU::synchronized_start() {
 //      line->open(audioFormat);
 //      line->start();
     // Start running the stream
-    SDL_PauseAudio(0);
+    if (!Globals::headless) {
+      SDL_PauseAudio(0);
+    }
 
   } catch (exception& e) {
     //System.out.println("Couldn't get sound lines->");
@@ -724,7 +731,7 @@ void PAPU::sample() {
       sampleBuffer[bufferIndex++] = static_cast<uint8_t>((sampleValueL >> 8) & 0xFF);
       sampleBuffer[bufferIndex++] = static_cast<uint8_t>((sampleValueR) & 0xFF);
       sampleBuffer[bufferIndex++] = static_cast<uint8_t>((sampleValueR >> 8) & 0xFF);
-    } else {
+    } else if (!Globals::uncapped) {
       mlog("audio drop data(4, %lu, %lu)", (size_t)bufferIndex, sampleBuffer.size());
     }
   } else {
@@ -732,7 +739,7 @@ void PAPU::sample() {
     if (bufferIndex + 2 < static_cast<int>(sampleBuffer.size())) {
       sampleBuffer[bufferIndex++] = static_cast<uint8_t>((sampleValueL) & 0xFF);
       sampleBuffer[bufferIndex++] = static_cast<uint8_t>((sampleValueL >> 8) & 0xFF);
-    } else {
+    } else if (!Globals::uncapped) {
       mlog("audio drop data(2, %lu)", sampleBuffer.size());
     }
   }
@@ -746,11 +753,23 @@ void PAPU::sample() {
 // Writes the sound buffer to the output line:
 void PAPU::writeBuffer() {
   bufferIndex -= (bufferIndex % (stereo ? 4 : 2));
+
+  // Headless: hand the frame's samples to the sink right away
+  if (Globals::headless) {
+    if (Globals::audio_sink && !_is_muted) {
+      Globals::audio_sink->on_samples(sampleBuffer.data(), bufferIndex);
+    }
+    bufferIndex = 0;
+    return;
+  }
+
   ready_for_buffer_write = true;
 }
 
 void PAPU::stop() {
-  SDL_PauseAudio(1);
+  if (!Globals::headless) {
+    SDL_PauseAudio(1);
+  }
   _is_running = false;
 }
 
@@ -9,11 +9,11 @@ Hosted at: https://github.com/workhorsy/SaltyNES
 #include "SaltyNES.h"
 
 const size_t PPU::UNDER_SCAN = 2;
-const size_t LINE_BUFFER_SZ = RES_WIDTH * sizeof(int32_t);
-static size_t last_fps = 0;
+const int PPU::SPRITE_BEHIND = 0x10;
+static atomic<size_t> last_fps(0);
 
 array<int, RES_PIXEL>* PPU::get_screen_buffer() {
-  return &_screen_buffer;
+  return _screen_buffer;
 }
 
 vector<int>* PPU::get_pattern_buffer() {
@@ -44,8 +44,10 @@ shared_ptr<PPU> PPU::Init(shared_ptr<NES> nes) {
   _frame_end.tv_sec = 0;
   _ticks_since_second = 0.0;
   frameCounter = 0;
+  cpuMem = nullptr;
   ppuMem = nullptr;
   sprMem = nullptr;
+  mp_frame_buffer = frame_buffer::get_frame_buffer();
 
   // Rendering Options:
   showSpr0Hit = false;
@@ -77,7 +79,6 @@ shared_ptr<PPU> PPU::Init(shared_ptr<NES> nes) {
   vramTmpAddress = 0;
   vramBufferedReadValue = 0;
   firstWrite = true;
-  vramMirrorTable.fill(0);
   i = 0;
 
   // SPR-RAM I/O:
@@ -103,7 +104,6 @@ shared_ptr<PPU> PPU::Init(shared_ptr<NES> nes) {
   vblankAdd = 0;
   curX = 0;
   scanline = 0;
-  lastRenderedScanline = 0;
   mapperIrqCounter = 0;
 
   // Sprite data:
@@ -114,9 +114,14 @@ shared_ptr<PPU> PPU::Init(shared_ptr<NES> nes) {
   vertFlip.fill(false);
   horiFlip.fill(false);
   bgPriority.fill(false);
+  lineSpriteCount.fill(0);
+  spriteLinesDirty = true;
+  spriteLinesSize = 0;
   spr0HitX = 0;
   spr0HitY = 0;
   hitSpr0 = false;
+  spr0CheckScan = 0;
+  spr0CheckPending = false;
 
   // Tiles:
   //ptTile.fill(nullptr);
@@ -128,6 +133,7 @@ shared_ptr<PPU> PPU::Init(shared_ptr<NES> nes) {
   // Palette data:
   sprPalette.fill(0);
   imgPalette.fill(0);
+  palColors = nullptr;
 
   // Misc:
   scanlineAlreadyRendered = false;
@@ -144,8 +150,8 @@ shared_ptr<PPU> PPU::Init(shared_ptr<NES> nes) {
 
   // Variables used when rendering:
   attrib.fill(0);
-  bgbuffer.fill(0);
-  pixrendered.fill(0);
+  bgLine.fill(0);
+  spriteLine.fill(0);
   //dummyPixPriTable = vector<int>(256 * 240, 0);
   //tpix = nullptr;
   requestRenderAll = false;
@@ -170,19 +176,26 @@ shared_ptr<PPU> PPU::Init(shared_ptr<NES> nes) {
   bufferSize = 0;
   available = 0;
   cycles = 0;
-  _screen_buffer.fill(0);
+  nextEventCycles = 0;
+  _screen_buffer = _frames.back();
+
+  // Throughput counters:
+  totalCycles = 0;
+  totalFrames = 0;
 
   return shared_from_this();
 }
 
 PPU::~PPU() {
   nes = nullptr;
+  cpuMem = nullptr;
   ppuMem = nullptr;
   sprMem = nullptr;
 }
 
 void PPU::init() {
   // Get the memory:
+  cpuMem = nes->getCpuMemory();
   ppuMem = nes->getPpuMemory();
   sprMem = nes->getSprMemory();
 
@@ -199,12 +212,11 @@ void PPU::init() {
     nameTable[i].name = name.str();
   }
 
-  // Initialize mirroring lookup table:
-  for (size_t i = 0; i < 0x8000; ++i) {
-    vramMirrorTable[i] = i;
-  }
+  // Pattern tables start out as CHR-RAM, the mapper maps any CHR-ROM:
+  mapChrBanks(0x0000, KB(8), ppuMem->mem.data(), ptTile.data());
+  ptDirty.reset();
+  ptAnyDirty = false;
 
-  lastRenderedScanline = -1;
   curX = 0;
 }
 
@@ -217,49 +229,25 @@ void PPU::setMirroring (int mirroring) {
   currentMirroring = mirroring;
   triggerRendering();
 
-  // Remove mirroring:
-  for(size_t i = 0; i < 0x8000; ++i) {
-    vramMirrorTable[i] = i;
-  }
-
-  // Palette mirroring:
-  defineMirrorRegion(0x3f20, 0x3f00, 0x20);
-  defineMirrorRegion(0x3f40, 0x3f00, 0x20);
-  defineMirrorRegion(0x3f80, 0x3f00, 0x20);
-  defineMirrorRegion(0x3fc0, 0x3f00, 0x20);
-
-  // Additional mirroring:
-  defineMirrorRegion(0x3000, 0x2000, 0xf00);
-  defineMirrorRegion(0x4000, 0x0000, 0x4000);
-
+  // Name table shown at $2000, $2400, $2800 and $2C00:
   switch (mirroring) {
     case ROM::HORIZONTAL_MIRRORING: {
       ntable1[0] = ntable1[1] = 0;
       ntable1[2] = ntable1[3] = 1;
-      defineMirrorRegion(0x2400, 0x2000, 0x400);
-      defineMirrorRegion(0x2c00, 0x2800, 0x400);
       break;
     }
     case ROM::VERTICAL_MIRRORING: {
       ntable1[0] = ntable1[2] = 0;
       ntable1[1] = ntable1[3] = 1;
-      defineMirrorRegion(0x2800, 0x2000, 0x400);
-      defineMirrorRegion(0x2c00, 0x2400, 0x400);
       break;
     }
     case ROM::SINGLESCREEN_MIRRORING: {
       // Single Screen mirroring
       std::fill_n(std::begin(ntable1), 4, 0);
-      defineMirrorRegion(0x2400, 0x2000, 0x400);
-      defineMirrorRegion(0x2800, 0x2000, 0x400);
-      defineMirrorRegion(0x2c00, 0x2000, 0x400);
       break;
     }
     case ROM::SINGLESCREEN_MIRRORING2: {
       std::fill_n(std::begin(ntable1), 4, 1);
-      defineMirrorRegion(0x2400, 0x2400, 0x400);
-      defineMirrorRegion(0x2800, 0x2400, 0x400);
-      defineMirrorRegion(0x2c00, 0x2400, 0x400);
       break;
     }
     default: {
@@ -270,29 +258,47 @@ void PPU::setMirroring (int mirroring) {
   }
 }
 
-// Define a mirrored area in the address lookup table.
-// Assumes the regions don't overlap.
-// The 'to' region is the region that is physically in memory.
-void PPU::defineMirrorRegion(size_t fromStart, size_t toStart, size_t size) {
-  for (size_t i = 0; i < size; ++i) {
-    vramMirrorTable[fromStart + i] = toStart + i;
+// Returns where a PPU address is stored in ppuMem. $4000-$7FFF repeat
+// $0000-$3FFF, $3000-$3EFF repeat the name tables, and the 32 palette
+// bytes repeat up to $3FFF. Name table n is stored at $2000 + n * $400.
+int PPU::mirrorAddress(int address) const {
+  address &= 0x3FFF;
+  if (address >= 0x3F00) {
+    return 0x3F00 | (address & 0x1F);
+  } else if (address >= 0x2000) {
+    return 0x2000 | (ntable1[(address >> 10) & 3] << 10) | (address & 0x3FF);
   }
+  return address;
 }
 
 // Emulates PPU cycles
 bool PPU::emulateCycles() {
   bool did_render = false;
-  //int n = (!requestEndFrame && curX+cycles<341 && (scanline-20 < spr0HitY || scanline-22 > spr0HitY))?cycles:1;
-  for (; cycles > 0; --cycles) {
-    if (scanline - 21 == spr0HitY) {
-      if ((curX == spr0HitX) && (f_spVisibility == 1)) {
-        // Set sprite 0 hit flag:
-        setStatusFlag(STATUS_SPRITE0HIT, true);
-      }
+  totalCycles += cycles;
+  while (cycles > 0) {
+    if (spr0CheckPending && scanline - 21 == spr0CheckScan) {
+      checkSprite0(spr0CheckScan);
+    }
+
+    // Run up to the next dot where something happens: the sprite 0 hit,
+    // the NMI countdown reaching 0, or the end of the scanline. Those
+    // happen on the last dot of the run, in the same order as before:
+    int n = std::min(cycles, 341 - curX);
+    const bool spr0Line = (!spr0CheckPending && scanline - 21 == spr0HitY && spr0HitX >= curX);
+    if (spr0Line) {
+      n = std::min(n, spr0HitX - curX + 1);
+    }
+    if (requestEndFrame && nmiCounter > 0) {
+      n = std::min(n, nmiCounter);
+    }
+
+    if (spr0Line && curX + n - 1 == spr0HitX && f_spVisibility == 1) {
+      // Set sprite 0 hit flag:
+      setStatusFlag(STATUS_SPRITE0HIT, true);
     }
 
     if (requestEndFrame) {
-      --nmiCounter;
+      nmiCounter -= n;
       if (nmiCounter == 0) {
         requestEndFrame = false;
         startVBlank();
@@ -300,21 +306,38 @@ bool PPU::emulateCycles() {
       }
     }
 
-    ++curX;
+    cycles -= n;
+    curX += n;
     if (curX == 341) {
       curX = 0;
       endScanline();
     }
   }
+
+  // Schedule the next point where the PPU can raise an interrupt
+  // or finish the frame. The CPU can run ahead until then:
+  nextEventCycles = 341 - curX;
+  if (requestEndFrame && nmiCounter < nextEventCycles) {
+    nextEventCycles = nmiCounter;
+  }
   return did_render;
 }
 
+// Emulates the cycles the CPU has run ahead. Called before the CPU
+// accesses anything the PPU reads or writes. It never reaches an event,
+// since the CPU stops running ahead at nextEventCycles.
+void PPU::catchUp() {
+  if (cycles > 0) {
+    emulateCycles();
+  }
+}
+
 static void render_fps() {
   if (Globals::printFps == false)
     return;
 
   std::stringstream ss;
-  ss << last_fps;
+  ss << last_fps.load();
   auto text =
       TTF_RenderText_Solid(
           Globals::g_osd_font,
@@ -334,28 +357,79 @@ void PPU::startVBlank() {
   // Do NMI:
   nes->getCpu()->requestIrq(CPU::IRQ_NMI);
 
-  // Make sure everything is rendered:
-  if (lastRenderedScanline < static_cast<int32_t>(RES_HEIGHT - 1)) {
-    renderFramePartially(lastRenderedScanline + 1, RES_HEIGHT - lastRenderedScanline);
-  }
+  // The next frame starts on a new tile row:
+  validTileData = false;
 
   endFrame();
   nes->papu->writeBuffer();
+  ++totalFrames;
 
-  // Actually draw the screen
-  // also render the FPS
+  // Headless has no window, keyboard, events or frame pacing
+  if (Globals::headless) {
+    if (Globals::video_sink) {
+      Globals::video_sink->on_frame(*_screen_buffer);
+    }
+    return;
+  }
+
+  // Hand the frame to the presentation and draw the next one into a free buffer:
+  _screen_buffer = _frames.publish();
+
+  // Without a render thread the frame is shown here:
+  if (!Globals::renderThread) {
+    presentFrame();
+    pollEvents();
+  }
 
-  SDL_UpdateTexture(Globals::g_screen, nullptr, _screen_buffer.data(), LINE_BUFFER_SZ);
+  // Figure out how much time we spent, and how much we have left
+  gettimeofday(&_frame_end, nullptr);
+  double e = _frame_end.tv_usec + (_frame_end.tv_sec * 1000000.0);
+  double s = _frame_start.tv_usec + (_frame_start.tv_sec * 1000000.0);
+  double diff = e - s;
+
+  // Sleep if there is still time left over, after drawing this frame
+  double wait = 0;
+  if(diff < Globals::MS_PER_FRAME && !Globals::uncapped) {
+    wait = Globals::MS_PER_FRAME - diff;
+#ifdef DESKTOP
+    SDL_Delay(wait / 1000.0f);
+#endif
+  }
+
+  // Print the frame rate
+  _ticks_since_second += diff + wait;
+  if(_ticks_since_second >= 1000000.0) {
+    last_fps = frameCounter;
+    _ticks_since_second = 0;
+    frameCounter = 0;
+  }
+  ++frameCounter;
+
+  // Get the start time of the next frame
+  gettimeofday(&_frame_start, nullptr);
+}
+
+// Shows the newest published frame, also renders the FPS. Returns false
+// when no frame was published since the last call.
+bool PPU::presentFrame() {
+  const TripleBuffer::Frame* frame = _frames.consume();
+  if (frame == nullptr) {
+    return false;
+  }
+
+  // Only the lines that changed since the last frame are uploaded:
+  mp_frame_buffer->set_frame(frame->data());
+  mp_frame_buffer->upload(Globals::g_screen);
   SDL_RenderClear(Globals::g_renderer);
   SDL_RenderCopy(Globals::g_renderer, Globals::g_screen, nullptr, nullptr);
   render_fps();
   SDL_RenderPresent(Globals::g_renderer);
+  return true;
+}
 
-  // Reset scanline counter:
-  lastRenderedScanline = -1;
-
-  startFrame();
-
+// Reads the keyboard and joysticks, and handles the SDL events. SDL wants
+// this on the thread that made the window, like presentFrame.
+void PPU::pollEvents() {
   // Check for key presses
   nes->_joy1->poll_for_key_events();
   //nes->_joy2->poll_for_key_events();
@@ -390,35 +464,13 @@ void PPU::startVBlank() {
           printf("Joystick removed: %d\n", id);
         }
         break;
+      case SDL_RENDER_TARGETS_RESET:
+      case SDL_RENDER_DEVICE_RESET:
+        // The texture may have lost its contents, upload all of it again:
+        mp_frame_buffer->invalidate();
+        break;
     }
   }
-
-  // Figure out how much time we spent, and how much we have left
-  gettimeofday(&_frame_end, nullptr);
-  double e = _frame_end.tv_usec + (_frame_end.tv_sec * 1000000.0);
-  double s = _frame_start.tv_usec + (_frame_start.tv_sec * 1000000.0);
-  double diff = e - s;
-
-  // Sleep if there is still time left over, after drawing this frame
-  double wait = 0;
-  if(diff < Globals::MS_PER_FRAME) {
-    wait = Globals::MS_PER_FRAME - diff;
-#ifdef DESKTOP
-    SDL_Delay(wait / 1000.0f);
-#endif
-  }
-
-  // Print the frame rate
-  _ticks_since_second += diff + wait;
-  if(_ticks_since_second >= 1000000.0) {
-    last_fps = frameCounter;
-    _ticks_since_second = 0;
-    frameCounter = 0;
-  }
-  ++frameCounter;
-
-  // Get the start time of the next frame
-  gettimeofday(&_frame_start, nullptr);
 }
 
 void PPU::endScanline() {
@@ -450,6 +502,7 @@ void PPU::endScanline() {
     hitSpr0 = false;
     spr0HitX = -1;
     spr0HitY = -1;
+    spr0CheckPending = false;
 
     if(f_bgVisibility == 1 || f_spVisibility == 1) {
 
@@ -462,7 +515,7 @@ void PPU::endScanline() {
 
       if(f_bgVisibility == 1) {
         // Render dummy scanline:
-        renderBgScanline(&_screen_buffer, 0);
+        renderBgScanline(0);
       }
 
     }
@@ -474,6 +527,8 @@ void PPU::endScanline() {
 
     }
 
+    renderScanline(0);
+
     if(f_bgVisibility == 1 || f_spVisibility == 1) {
       // Clock mapper IRQ Counter:
       nes->memMapper->clockIrqCounter();
@@ -488,7 +543,7 @@ void PPU::endScanline() {
         // update scroll:
         cntHT = regHT;
         cntH = regH;
-        renderBgScanline(&bgbuffer, scanline + 1 - 21);
+        renderBgScanline(scanline + 1 - 21);
       }
       scanlineAlreadyRendered = false;
 
@@ -504,6 +559,10 @@ void PPU::endScanline() {
 
     }
 
+    if(scanline + 1 - 21 < static_cast<int>(RES_HEIGHT)) {
+      renderScanline(scanline + 1 - 21);
+    }
+
     if(f_bgVisibility == 1 || f_spVisibility == 1) {
       // Clock mapper IRQ Counter:
       nes->memMapper->clockIrqCounter();
@@ -528,24 +587,20 @@ void PPU::endScanline() {
 
 }
 
-void PPU::startFrame() {
-  // Set background color:
-  int bgColor = 0;
-
+// The color of transparent pixels.
+int PPU::backgroundColor() const {
   if (f_dispType == 0) {
     // Color display.
     // f_color determines color emphasis.
     // Use first entry of image palette as BG color.
-    bgColor = imgPalette[0];
-  } else {
-    const int bg_values[] = { 0x00, 0xff00, 0xff0000, 0x00, 0xff };
-    if (f_color < sizeof(bg_values)) {
-      bgColor = bg_values[f_color];
-    }
+    return imgPalette[0];
   }
 
-  std::fill(_screen_buffer.begin(), _screen_buffer.end(), bgColor);
-  std::fill(pixrendered.begin(), pixrendered.end(), 65);
+  const int bg_values[] = { 0x00, 0xff00, 0xff0000, 0x00, 0xff };
+  if (f_color < sizeof(bg_values)) {
+    return PaletteTable::toPixel(bg_values[f_color]);
+  }
+  return PaletteTable::toPixel(0);
 }
 
 void PPU::endFrame() {
@@ -558,25 +613,30 @@ void PPU::endFrame() {
     if ((0 <= sprx_0 && sprx_0 < RES_WIDTH) &&
         (0 <= spry_0 && spry_0 < RES_HEIGHT)) {
       const auto spry_0x256 = (spry_0 << 8);
-      std::fill_n(_screen_buffer.begin() + spry_0x256, RES_WIDTH, 0xFF5555);
+      const int color = PaletteTable::toPixel(0xFF5555);
+      std::fill_n(_screen_buffer->begin() + spry_0x256, RES_WIDTH, color);
 
       /* vertical access */
-      int* const shifted_head = (int*)(_screen_buffer.data()) + sprx_0;
+      int* const shifted_head = (int*)(_screen_buffer->data()) + sprx_0;
       for (size_t i = 0; i < RES_HEIGHT; ++i) {
-        shifted_head[(i << 8)] = 0xFF5555;
+        shifted_head[(i << 8)] = color;
       }
     }
 
     // Hit position:
+    if (spr0CheckPending) {
+      checkSprite0(spr0CheckScan);
+    }
     if ((spr0HitX >= 0 && spr0HitX < RES_WIDTH) &&
         (spr0HitY >= 0 && spr0HitY < RES_HEIGHT)) {
       const auto spr0HitYx256 = (spr0HitY << 8);
-      std::fill_n(_screen_buffer.begin() + spr0HitYx256, RES_WIDTH, 0x55FF55);
+      const int color = PaletteTable::toPixel(0x55FF55);
+      std::fill_n(_screen_buffer->begin() + spr0HitYx256, RES_WIDTH, color);
 
       /* vertical access */
-      int* const shifted_head = (int*)(_screen_buffer.data()) + spr0HitX;
+      int* const shifted_head = (int*)(_screen_buffer->data()) + spr0HitX;
       for (size_t i = 0; i < RES_HEIGHT; ++i) {
-        shifted_head[(i << 8)] = 0x55FF55;
+        shifted_head[(i << 8)] = color;
       }
     }
   }
@@ -607,23 +667,25 @@ void PPU::updateControlReg2(int value) {
   f_bgClipping = (value >> 1) & 1;
   f_dispType = value & 1;
 
-  if(f_dispType == 0) {
-    nes->palTable->setEmphasis(f_color);
+  // Switch to the colors of the new emphasis/display type:
+  const int* colors = nes->palTable->getTable(f_color, f_dispType);
+  if(colors != palColors) {
+    palColors = colors;
+    updatePalettes();
   }
-  updatePalettes();
 }
 
 void PPU::setStatusFlag(int flag, bool value) {
   int n = 1 << flag;
-  int memValue = nes->getCpuMemory()->load(0x2002);
+  int memValue = cpuMem->load(0x2002);
   memValue = ((memValue & (255 - n)) | (value ? n : 0));
-  nes->getCpuMemory()->write(0x2002, static_cast<uint16_t>(memValue));
+  cpuMem->write(0x2002, static_cast<uint16_t>(memValue));
 }
 
 // CPU Register $2002:
 // Read the Status Register.
 uint16_t PPU::readStatusRegister() {
-  tmp = nes->getCpuMemory()->load(0x2002);
+  tmp = cpuMem->load(0x2002);
 
   // Reset scroll & VRAM Address toggle:
   firstWrite = true;
@@ -705,7 +767,7 @@ void PPU::writeVRAMAddress(int address) {
     cntVT = regVT;
     cntHT = regHT;
 
-    checkSprite0(scanline - vblankAdd + 1 - 21);
+    requestSprite0Check(scanline - vblankAdd + 1 - 21);
 
   }
 
@@ -731,7 +793,7 @@ uint16_t PPU::vramLoad() {
 
     // Update buffered value:
     if(vramAddress < 0x2000) {
-      vramBufferedReadValue = ppuMem->load(vramAddress);
+      vramBufferedReadValue = chrBank[vramAddress >> 10][vramAddress & 0x3FF];
     } else {
       vramBufferedReadValue = mirroredLoad(vramAddress);
     }
@@ -792,13 +854,22 @@ void PPU::vramWrite(uint16_t value) {
 // Write 256 bytes of main memory
 // into Sprite RAM.
 void PPU::sramDMA(uint16_t value) {
-  shared_ptr<Memory> cpuMem = nes->getCpuMemory();
   int baseAddress = value * 0x100;
-  uint16_t data;
-  for(size_t i = sramAddress; i < 256; ++i) {
-    data = cpuMem->load(baseAddress + i);
-    sprMem->write(i, data);
-    spriteRamWriteUpdate(i, data);
+  const uint8_t* page = nes->memMapper->readPage[value & 0xFF];
+  if (page != nullptr) {
+    // Mapped RAM or ROM: copy the page and decode the sprites once:
+    std::copy(page + sramAddress, page + 256, sprMem->mem.begin() + sramAddress);
+    decodeSprites(sramAddress >> 2);
+    if (sramAddress < 4) {
+      requestSprite0Check(scanline + 1 - vblankAdd - 21);
+    }
+  } else {
+    uint16_t data;
+    for(size_t i = sramAddress; i < 256; ++i) {
+      data = cpuMem->load(baseAddress + i);
+      sprMem->write(i, data);
+      spriteRamWriteUpdate(i, data);
+    }
   }
 
   nes->getCpu()->haltCycles(513);
@@ -879,7 +950,7 @@ void PPU::incTileCounter(int count) {
 // Reads from memory, taking into account
 // mirroring/mapping of address ranges.
 uint16_t PPU::mirroredLoad(int address) {
-  return ppuMem->load(vramMirrorTable[address]);
+  return ppuMem->load(mirrorAddress(address));
 }
 
 // Writes to memory, taking into account
@@ -917,9 +988,8 @@ void PPU::mirroredWrite(int address, uint16_t value) {
 
   } else {
 
-    // Use lookup table for mirrored address:
-    if(address < static_cast<int>(vramMirrorTable.size())) {
-      writeMem(vramMirrorTable[address], value);
+    if(address < 0x8000) {
+      writeMem(mirrorAddress(address), value);
     } else {
       //System.out.println("Invalid VRAM address: "+Misc.hex16(address));
       nes->getCpu()->setCrashed(true);
@@ -928,45 +998,69 @@ void PPU::mirroredWrite(int address, uint16_t value) {
   }
 }
 
+// Called before register writes and bank switches that change what is
+// drawn. Lines are drawn as they finish, so only the fetched tiles of
+// the current row need to be dropped.
 void PPU::triggerRendering() {
-  if(scanline - vblankAdd >= 21 && scanline - vblankAdd <= 260) {
-
-    // Render sprites, and combine:
-    renderFramePartially(lastRenderedScanline + 1, scanline - vblankAdd - 21 - lastRenderedScanline);
-
-    // Set last rendered scanline:
-    lastRenderedScanline = scanline - vblankAdd - 21;
-  }
+  validTileData = false;
 }
 
-void PPU::renderFramePartially(int startScan, int scanCount) {
-  const bool render_sprites =
-      (f_spVisibility == 1 && !Globals::disableSprites);
-  if (render_sprites)  {
-    renderSpritesPartially(startScan, scanCount, true);
+// Draws a finished line to the screen in one pass, from the background
+// and sprite line buffers.
+void PPU::renderScanline(int scan) {
+  int* dest = _screen_buffer->data() + (scan << 8);
+  const int bgColor = backgroundColor();
+  const bool showBg = (f_bgVisibility == 1);
+  const bool showSprites =
+      (f_spVisibility == 1 && !Globals::disableSprites && renderSpriteLine(scan));
+
+  if (!showSprites) {
+    for (size_t x = 0; x < RES_WIDTH; ++x) {
+      const int bg = (showBg ? bgLine[x] : 0);
+      dest[x] = (bg != 0 ? imgPalette[bg] : bgColor);
+    }
+    return;
   }
 
-  if (f_bgVisibility == 1) {
-    si = startScan << 8;
-    ei = std::max(((startScan + scanCount) << 8), 0xf000);
-
-    for (destIndex = si; destIndex < ei; ++destIndex) {
-      if (pixrendered[destIndex] > 0xFF) {
-        _screen_buffer[destIndex] = bgbuffer[destIndex];
-      }
+  for (size_t x = 0; x < RES_WIDTH; ++x) {
+    const int bg = (showBg ? bgLine[x] : 0);
+    const int spr = spriteLine[x];
+    if (spr != 0 && (bg == 0 || (spr & SPRITE_BEHIND) == 0)) {
+      dest[x] = sprPalette[spr & 0xF];
+    } else {
+      dest[x] = (bg != 0 ? imgPalette[bg] : bgColor);
     }
   }
+}
 
-  if (render_sprites)  {
-    renderSpritesPartially(startScan, scanCount, false);
+#if defined(__GNUC__)
+#define PPU_VECTOR_BG
+// Four pixels per vector. GCC and Clang lower this to SSE2, NEON or
+// WebAssembly SIMD128 (with -msimd128).
+typedef int32_t pix4 __attribute__((vector_size(16)));
+
+// Expands one 2bpp tile row to the image palette indexes of its 8
+// pixels, or 0 for transparent pixels.
+static inline void renderBgRow(int* dest, const int row, const int att) {
+  static const pix4 lowBits[2] = {
+    { 1 << 14, 1 << 12, 1 << 10, 1 << 8 },
+    { 1 << 6, 1 << 4, 1 << 2, 1 << 0 }
+  };
+  const pix4 r = { row, row, row, row };
+  const pix4 base = { att, att, att, att };
+  for (int half = 0; half < 2; ++half) {
+    // All ones where the bit is set:
+    const pix4 lo = (r & lowBits[half]) != 0;
+    const pix4 hi = (r & (lowBits[half] << 1)) != 0;
+    const pix4 index = (lo | hi) & ((lo & 1) + (hi & 2) + base);
+    memcpy(dest + half * 4, &index, sizeof(index));
   }
-
-  validTileData = false;
 }
+#endif
 
-void PPU::renderBgScanline(array<int, RES_PIXEL>* buffer, int scan) {
+void PPU::renderBgScanline(int scan) {
   baseTile = (regS == 0 ? 0 : 256);
-  destIndex = (scan << 8) - regFH;
+  destIndex = -regFH;
   curNt = ntable1[cntV + cntV + cntH];
 
   cntHT = regHT;
@@ -989,7 +1083,7 @@ void PPU::renderBgScanline(array<int, RES_PIXEL>* buffer, int scan) {
           att = attrib[tile];
         } else {
           // Fetch data:
-          t = &(ptTile[baseTile + nameTable[curNt].getTileIndex(cntHT, cntVT)]);
+          t = &patternTile(baseTile + nameTable[curNt].getTileIndex(cntHT, cntVT));
           //tpix = &t->pix;
           att = nameTable[curNt].getAttrib(cntHT, cntVT);
           scantile[tile] = t;
@@ -1004,23 +1098,17 @@ void PPU::renderBgScanline(array<int, RES_PIXEL>* buffer, int scan) {
             destIndex -= x;
             sx = -x;
           }
-          if (t->getOpaque(cntFV)) {
-            for(; sx < 8; ++sx) {
-              //(*buffer)[destIndex] = imgPalette[(*tpix)[tscanoffset + sx] + att];
-              (*buffer)[destIndex] = imgPalette[t->getPix(tscanoffset + sx) + att];
-              pixrendered[destIndex] |= 256;
-              ++destIndex;
-            }
-          } else {
-            for(; sx < 8; ++sx) {
-              col = t->getPix(tscanoffset + sx);
-              //col = (*tpix)[tscanoffset + sx];
-              if(col != 0) {
-                (*buffer)[destIndex] = imgPalette[col + att];
-                pixrendered[destIndex] |= 256;
-              }
-              ++destIndex;
-            }
+          const int row = t->getRow(cntFV);
+#ifdef PPU_VECTOR_BG
+          if (x >= 0 && Globals::simdBackground) {
+            renderBgRow(&bgLine[destIndex], row, att);
+            destIndex += 8;
+          } else
+#endif
+          for(; sx < 8; ++sx) {
+            col = (row >> ((7 - sx) << 1)) & 3;
+            bgLine[destIndex] = (col != 0 ? col + att : 0);
+            ++destIndex;
           }
         }
       }
@@ -1038,6 +1126,11 @@ void PPU::renderBgScanline(array<int, RES_PIXEL>* buffer, int scan) {
     // Tile data for one row should now have been fetched,
     // so the data in the array is valid.
     validTileData = true;
+
+    // The 32 tiles stop short of the right edge when scrolled:
+    std::fill(bgLine.begin() + destIndex, bgLine.end(), 0);
+  } else {
+    bgLine.fill(0);
   }
 
   // update vertical scroll:
@@ -1059,67 +1152,115 @@ void PPU::renderBgScanline(array<int, RES_PIXEL>* buffer, int scan) {
   }
 }
 
-void PPU::renderSpritesPartially(int startscan, int scancount, bool bgPri) {
-  if (f_spVisibility != 1)
-    return;
-
-  const int endscan = startscan + scancount;
-  for (size_t i = 0; i < 64; ++i) {
-    const int sprXi = sprX[i];
-    const int sprYi = sprY[i];
-    if (bgPriority[i] == bgPri &&
-        sprXi >= 0 && sprXi < RES_WIDTH &&
-        sprYi + 8 >= startscan && sprYi < endscan) {
-      // render sprites
-      // 8x8 sprites
-      if (f_spriteSize == 0) {
-        /* calibrate the starting & ending Y inside the 8x8 sprite */
-        const int srcy1 = std::max(0, startscan - sprY[i] - 1);
-        const int srcy2 = std::min(8, startscan + scancount - sprY[i] + 1);
-        const auto tile_index = sprTile[i] + 256 * f_spPatternTable;
-        ptTile[tile_index].render(
-            0, srcy1, 8, srcy2,
-            sprX[i], sprY[i] + 1,
-            &_screen_buffer, sprCol[i], &sprPalette, horiFlip[i], vertFlip[i], i, &pixrendered);
-      } else {
-        // 8x16 sprites (actually 2 8x8 sprites at a time)
-        int top = sprTile[i];
-        if((top & 1) != 0) {
-          top = sprTile[i] - 1 + 256;
-        }
-
-        int srcy1 = 0;  /* starting y in the sprite */
-        int srcy2 = 8;  /* ending y in the sprite */
+// Renders the background of count frames, 240 scanlines each, and
+// returns the average time per scanline in nanoseconds. The scroll
+// counters are restored afterwards.
+double PPU::benchmarkBgScanlines(int frames) {
+  const int savedFV = cntFV, savedV = cntV, savedH = cntH, savedVT = cntVT, savedHT = cntHT;
+  const int savedNt = curNt;
+  const bool savedValid = validTileData;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < frames; ++frame) {
+    cntFV = savedFV;
+    cntV = savedV;
+    cntH = savedH;
+    cntVT = savedVT;
+    for (int scan = 0; scan < 240; ++scan) {
+      validTileData = false;
+      renderBgScanline(scan);
+    }
+  }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+  cntFV = savedFV;
+  cntV = savedV;
+  cntH = savedH;
+  cntVT = savedVT;
+  cntHT = savedHT;
+  curNt = savedNt;
+  validTileData = savedValid;
+  return frames > 0 ? elapsed.count() / (frames * 240.0) : 0.0;
+}
 
-        /* if starting scanline is lower then Y. (not the whole sprite will be printed) */
-        if (sprY[i] < startscan) {
-          srcy1 = startscan - sprY[i] - 1;
-        }
+// Builds the list of sprites on each scanline. Like vNES, sprites are
+// drawn one line below their Y coordinate.
+void PPU::evaluateSprites() {
+  const int height = (f_spriteSize == 0 ? 8 : 16);
+  const int limit = (Globals::spriteLimit ? 8 : static_cast<int>(N_SPRITES));
+  lineSpriteCount.fill(0);
+  for (int i = 0; i < static_cast<int>(N_SPRITES); ++i) {
+    const int top = sprY[i] + 1;
+    const int bottom = std::min(top + height, static_cast<int>(RES_HEIGHT));
+    for (int line = top; line < bottom; ++line) {
+      if (lineSpriteCount[line] < limit) {
+        lineSprites[line][lineSpriteCount[line]++] = i;
+      }
+    }
+  }
 
-        if (sprY[i] + 8 > startscan + scancount) {
-          srcy2 = startscan + scancount - sprY[i];
-        }
+  spriteLinesDirty = false;
+  spriteLinesSize = f_spriteSize;
+}
 
-        ptTile[top + (vertFlip[i] != 0)].render(0, srcy1, 8, srcy2, sprX[i], sprY[i] + 1, &_screen_buffer, sprCol[i], &sprPalette, horiFlip[i], vertFlip[i], i, &pixrendered);
+// Draws one 2bpp sprite row to the sprite line. Pixels already taken
+// by a lower numbered sprite are kept, even if that one is behind the
+// background.
+static inline void renderSpriteRow(uint8_t* line, const int row, const int x, const bool flip, const int attributes) {
+  const int end = std::min(8, static_cast<int>(RES_WIDTH) - x);
+  for (int px = 0; px < end; ++px) {
+    const int col = (row >> ((flip ? px : 7 - px) << 1)) & 3;
+    if (col != 0 && line[x + px] == 0) {
+      line[x + px] = attributes + col;
+    }
+  }
+}
 
-        srcy1 = 0;
-        srcy2 = 8;
+// Fills the sprite line for a scanline. Returns false if no sprite is on it.
+bool PPU::renderSpriteLine(int scan) {
+  if (spriteLinesDirty || spriteLinesSize != f_spriteSize) {
+    evaluateSprites();
+  }
 
-        if(sprY[i] + 8 < startscan) {
-          srcy1 = startscan - (sprY[i] + 8 + 1);
-        }
+  const int count = lineSpriteCount[scan];
+  if (count == 0) {
+    return false;
+  }
 
-        if(sprY[i] + 16 > startscan + scancount) {
-          srcy2 = startscan + scancount - (sprY[i] + 8);
-        }
+  spriteLine.fill(0);
+  for (int n = 0; n < count; ++n) {
+    const int i = lineSprites[scan][n];
+    int row = scan - sprY[i] - 1;
+    int tile_index;
+    if (f_spriteSize == 0) {
+      tile_index = sprTile[i] + 256 * f_spPatternTable;
+    } else {
+      // 8x16 sprites: two tiles, swapped when flipped vertically
+      const int top = ((sprTile[i] & 1) != 0 ? sprTile[i] - 1 + 256 : sprTile[i]);
+      tile_index = top + ((row >= 8) != vertFlip[i]);
+      row &= 7;
+    }
 
-        ptTile[top + (vertFlip[i] ? 0 : 1)].render(0, srcy1, 8, srcy2, sprX[i], sprY[i] + 1 + 8, &_screen_buffer, sprCol[i], &sprPalette, horiFlip[i], vertFlip[i], i, &pixrendered);
-      }
+    if (vertFlip[i]) {
+      row = 7 - row;
     }
+    const int attributes = sprCol[i] | (bgPriority[i] ? SPRITE_BEHIND : 0);
+    renderSpriteRow(spriteLine.data(), patternTile(tile_index).getRow(row), sprX[i], horiFlip[i], attributes);
   }
+  return true;
+}
+
+// Writes that can move the sprite #0 hit only record the scanline to
+// check. The check runs when the PPU reaches that scanline, so a DMA or
+// a name table upload does it once instead of on every byte. Until
+// then, no hit is pending on the current scanline.
+void PPU::requestSprite0Check(int scan) {
+  spr0CheckScan = scan;
+  spr0CheckPending = true;
 }
 
 bool PPU::checkSprite0(int scan) {
+  spr0CheckPending = false;
   spr0HitX = -1;
   spr0HitY = -1;
 
@@ -1127,7 +1268,7 @@ bool PPU::checkSprite0(int scan) {
   int tIndexAdd = (f_spPatternTable == 0 ? 0 : 256);
   int x, y;
   int bufferIndex;
-  Tile* t;
+  const Tile* t;
 
   x = sprX[0];
   y = sprY[0] + 1;
@@ -1141,7 +1282,7 @@ bool PPU::checkSprite0(int scan) {
 
       // Sprite is in range.
       // Draw scanline:
-      t = &(ptTile[sprTile[0] + tIndexAdd]);
+      t = &patternTile(sprTile[0] + tIndexAdd);
       //col = sprCol[0];
       //bgPri = bgPriority[0];
 
@@ -1156,7 +1297,7 @@ bool PPU::checkSprite0(int scan) {
       if(horiFlip[0]) {
         for(int i = 7; i >= 0; --i) {
           if(x >= 0 && x < 256) {
-            if(bufferIndex >= 0 && bufferIndex < 61440 && pixrendered[bufferIndex] != 0) {
+            if(bufferIndex >= 0 && bufferIndex < 61440) {
               if(t->getPix(toffset + i) != 0) {
                 spr0HitX = bufferIndex % 256;
                 spr0HitY = scan;
@@ -1172,7 +1313,7 @@ bool PPU::checkSprite0(int scan) {
 
         for(size_t i = 0; i < 8; ++i) {
           if(x >= 0 && x < 256) {
-            if(bufferIndex >= 0 && bufferIndex < 61440 && pixrendered[bufferIndex] != 0) {
+            if(bufferIndex >= 0 && bufferIndex < 61440) {
               if(t->getPix(toffset + i) != 0) {
                 spr0HitX = bufferIndex % 256;
                 spr0HitY = scan;
@@ -1207,10 +1348,10 @@ bool PPU::checkSprite0(int scan) {
 
       if(toffset < 8) {
         // first half of sprite.
-        t = &(ptTile[sprTile[0] + (vertFlip[0] ? 1 : 0) + ((sprTile[0] & 1) != 0 ? 255 : 0)]);
+        t = &patternTile(sprTile[0] + (vertFlip[0] ? 1 : 0) + ((sprTile[0] & 1) != 0 ? 255 : 0));
       } else {
         // second half of sprite.
-        t = &(ptTile[sprTile[0] + (vertFlip[0] ? 0 : 1) + ((sprTile[0] & 1) != 0 ? 255 : 0)]);
+        t = &patternTile(sprTile[0] + (vertFlip[0] ? 0 : 1) + ((sprTile[0] & 1) != 0 ? 255 : 0));
         if(vertFlip[0]) {
           toffset = 15 - toffset;
         } else {
@@ -1226,7 +1367,7 @@ bool PPU::checkSprite0(int scan) {
 
         for(int i = 7; i >= 0; --i) {
           if(x >= 0 && x < 256) {
-            if(bufferIndex >= 0 && bufferIndex < 61440 && pixrendered[bufferIndex] != 0) {
+            if(bufferIndex >= 0 && bufferIndex < 61440) {
               if(t->getPix(toffset + i)) {
                 spr0HitX = bufferIndex % 256;
                 spr0HitY = scan;
@@ -1242,7 +1383,7 @@ bool PPU::checkSprite0(int scan) {
 
         for(size_t i = 0; i < 8; ++i) {
           if(x >= 0 && x < 256) {
-            if(bufferIndex >= 0 && bufferIndex < 61440 && pixrendered[bufferIndex] != 0) {
+            if(bufferIndex >= 0 && bufferIndex < 61440) {
               if (t->getPix(toffset + i)) {
                 spr0HitX = bufferIndex % 256;
                 spr0HitY = scan;
@@ -1371,43 +1512,22 @@ void PPU::writeMem(int address, uint16_t value) {
   if(address < 0x2000) {
 
     ppuMem->write(address, value);
-    patternWrite(address, value);
-
-  } else if(address >= 0x2000 && address < 0x23c0) {
-
-    nameTableWrite(ntable1[0], address - 0x2000, value);
-
-  } else if(address >= 0x23c0 && address < 0x2400) {
-
-    attribTableWrite(ntable1[0], address - 0x23c0, value);
-
-  } else if(address >= 0x2400 && address < 0x27c0) {
+    patternWrite(address);
 
-    nameTableWrite(ntable1[1], address - 0x2400, value);
+  } else if(address >= 0x2000 && address < 0x3000) {
 
-  } else if(address >= 0x27c0 && address < 0x2800) {
-
-    attribTableWrite(ntable1[1], address - 0x27c0, value);
-
-  } else if(address >= 0x2800 && address < 0x2bc0) {
-
-    nameTableWrite(ntable1[2], address - 0x2800, value);
-
-  } else if(address >= 0x2bc0 && address < 0x2c00) {
-
-    attribTableWrite(ntable1[2], address - 0x2bc0, value);
-
-  } else if(address >= 0x2c00 && address < 0x2fc0) {
-
-    nameTableWrite(ntable1[3], address - 0x2c00, value);
-
-  } else if(address >= 0x2fc0 && address < 0x3000) {
-
-    attribTableWrite(ntable1[3], address - 0x2fc0, value);
+    // Name table and its attribute table:
+    const int index = (address >> 10) & 3;
+    const int offset = address & 0x3FF;
+    if(offset < 0x3c0) {
+      nameTableWrite(index, offset, value);
+    } else {
+      attribTableWrite(index, offset - 0x3c0, value);
+    }
 
   } else if(address >= 0x3f00 && address < 0x3f20) {
 
-    updatePalettes();
+    updatePaletteEntry(address & 0x1F);
 
   }
 }
@@ -1415,50 +1535,61 @@ void PPU::writeMem(int address, uint16_t value) {
 // Reads data from $3f00 to $f20
 // into the two buffered palettes.
 void PPU::updatePalettes() {
-  for(size_t i = 0; i < 16; ++i) {
-    if(f_dispType == 0) {
-      imgPalette[i] = nes->palTable->getEntry(ppuMem->load(0x3f00 + i) & 63);
-    } else {
-      imgPalette[i] = nes->palTable->getEntry(ppuMem->load(0x3f00 + i) & 32);
-    }
-  }
-  for(size_t i = 0; i < 16; ++i) {
-    if(f_dispType == 0) {
-      sprPalette[i] = nes->palTable->getEntry(ppuMem->load(0x3f10 + i) & 63);
-    } else {
-      sprPalette[i] = nes->palTable->getEntry(ppuMem->load(0x3f10 + i) & 32);
-    }
+  for(int i = 0; i < 32; ++i) {
+    updatePaletteEntry(i);
   }
 }
 
-// Updates the internal pattern
-// table buffers with this new byte.
-void PPU::patternWrite(int address, uint16_t value) {
-  int tileIndex = address / 16;
-  int leftOver = address % 16;
-  if(leftOver < 8) {
-    ptTile[tileIndex].setScanline(leftOver, value, ppuMem->load(address + 8));
+// Converts palette entry index ($3f00 + index) to RGB
+// with the current emphasis and display type.
+void PPU::updatePaletteEntry(int index) {
+  const int color = palColors[ppuMem->mem[0x3f00 + index] & 63];
+  if(index < 16) {
+    imgPalette[index] = color;
   } else {
-    ptTile[tileIndex].setScanline(leftOver - 8, ppuMem->load(address - 8), value);
+    sprPalette[index - 16] = color;
   }
 }
 
-void PPU::patternWrite(int address, vector<uint16_t>* value, size_t offset, size_t length) {
-  int tileIndex;
-  int leftOver;
+// Points the pattern table banks of [address, address + length)
+// at data and its decoded tiles.
+void PPU::mapChrBanks(int address, int length, const uint8_t* data, const Tile* tiles) {
+  for (int offset = 0; offset < length; offset += KB(1)) {
+    chrBank[(address + offset) >> 10] = data + offset;
+    ptBank[(address + offset) >> 10] = tiles + (offset >> 4);
+  }
+}
 
-  for(size_t i = 0; i < length; ++i) {
+// Save states keep the pattern bytes in ppuMem, so copy the mapped
+// CHR-ROM banks there.
+void PPU::syncChrMemory() {
+  for (size_t bank = 0; bank < chrBank.size(); ++bank) {
+    uint8_t* dest = &ppuMem->mem[bank << 10];
+    if (chrBank[bank] != dest) {
+      std::copy(chrBank[bank], chrBank[bank] + KB(1), dest);
+    }
+  }
+}
 
-    tileIndex = (address + i) >> 4;
-    leftOver = (address + i) % 16;
+// Marks the CHR-RAM tile holding this byte for decoding.
+// Writes always go to CHR-RAM, so they don't show while CHR-ROM is mapped.
+void PPU::patternWrite(int address) {
+  ptDirty.set(address >> 4);
+  ptAnyDirty = true;
+}
 
-    if(leftOver < 8) {
-      ptTile[tileIndex].setScanline(leftOver, (*value)[offset + i], ppuMem->load(address + 8 + i));
-    } else {
-      ptTile[tileIndex].setScanline(leftOver - 8, ppuMem->load(address - 8 + i), (*value)[offset + i]);
+// Decodes the CHR-RAM tiles written since they were last rendered.
+void PPU::decodeDirtyTiles() {
+  for(size_t i = 0; i < ptTile.size(); ++i) {
+    if(ptDirty[i]) {
+      const size_t address = i << 4;
+      for(size_t y = 0; y < 8; ++y) {
+        ptTile[i].setScanline(y, ppuMem->mem[address + y], ppuMem->mem[address + y + 8]);
+      }
     }
-
   }
+  ptDirty.reset();
+  ptAnyDirty = false;
 }
 
 void PPU::invalidateFrameCache() {
@@ -1472,8 +1603,7 @@ void PPU::nameTableWrite(int index, int address, uint16_t value) {
   nameTable[index].writeTileIndex(address, value);
 
   // Update Sprite #0 hit:
-  //updateSpr0Hit();
-  checkSprite0(scanline + 1 - vblankAdd - 21);
+  requestSprite0Check(scanline + 1 - vblankAdd - 21);
 }
 
 // Updates the internal pattern
@@ -1483,19 +1613,34 @@ void PPU::attribTableWrite(int index, int address, uint16_t value) {
   nameTable[index].writeAttrib(address, value);
 }
 
+// Decodes the sprites from first to the last one out of sprite memory.
+void PPU::decodeSprites(int first) {
+  const uint8_t* oam = sprMem->mem.data();
+  for (size_t i = first; i < N_SPRITES; ++i) {
+    const uint8_t* sprite = oam + (i << 2);
+    sprY[i] = sprite[0];
+    sprTile[i] = sprite[1];
+    vertFlip[i] = ((sprite[2] & 0x80) != 0);
+    horiFlip[i] = ((sprite[2] & 0x40) != 0);
+    bgPriority[i] = ((sprite[2] & 0x20) != 0);
+    sprCol[i] = (sprite[2] & 3) << 2;
+    sprX[i] = sprite[3];
+  }
+  spriteLinesDirty = true;
+}
+
 // Updates the internally buffered sprite
 // data with this new byte of info.
 void PPU::spriteRamWriteUpdate(int address, uint16_t value) {
   const int tIndex = (address >> 2);
   if (tIndex == 0) {
-    //updateSpr0Hit();
-    checkSprite0(scanline + 1 - vblankAdd - 21);
+    requestSprite0Check(scanline + 1 - vblankAdd - 21);
   }
 
   /* get last 2 bits */
   const int remainder = (address & 0x03);
   switch (remainder) {
-    case 0: sprY[tIndex] = value; break;
+    case 0: sprY[tIndex] = value; spriteLinesDirty = true; break;
     case 1: sprTile[tIndex] = value; break;
     case 2: {
       vertFlip[tIndex] = ((value & 0x80) != 0);
@@ -1550,8 +1695,9 @@ void PPU::statusRegsFromInt(int n) {
 }
 
 void PPU::stateLoad(ByteBuffer* buf) {
-  // Check version:
-  if(buf->readByte() == 1) {
+  // Check version. Version 1 also has the old frame buffers:
+  const int version = buf->readByte();
+  if(version >= 1 && version <= 3) {
 
     // Counters:
     cntFV = buf->readInt();
@@ -1586,11 +1732,12 @@ void PPU::stateLoad(ByteBuffer* buf) {
     //System.out.println("firstWrite: "+firstWrite);
 
 
-    // Mirroring:
-    //currentMirroring = -1;
-    //setMirroring(buf->readInt());
-    for (size_t i = 0; i < vramMirrorTable.size(); ++i) {
-      vramMirrorTable[i] = buf->readInt();
+    // Versions 1 and 2 have the old mirroring lookup table. The name
+    // table map below replaces it:
+    if(version < 3) {
+      for (size_t i = 0; i < 0x8000; ++i) {
+        buf->readInt();
+      }
     }
 
 
@@ -1600,7 +1747,9 @@ void PPU::stateLoad(ByteBuffer* buf) {
     // Rendering progression:
     curX = buf->readInt();
     scanline = buf->readInt();
-    lastRenderedScanline = buf->readInt();
+    if(version == 1) {
+      buf->readInt();
+    }
 
 
     // Misc:
@@ -1609,15 +1758,14 @@ void PPU::stateLoad(ByteBuffer* buf) {
     dummyCycleToggle = buf->readBoolean();
     nmiCounter = buf->readInt();
     tmp = static_cast<uint16_t>(buf->readInt());
+    cycles = 0;
+    nextEventCycles = 0;
 
 
-    // Stuff used during rendering:
-    for (size_t i = 0; i < bgbuffer.size(); ++i) {
-      bgbuffer[i] = buf->readByte();
-    }
-
-    for (size_t i = 0; i < pixrendered.size(); ++i) {
-      pixrendered[i] = buf->readByte();
+    if(version == 1) {
+      for (size_t i = 0; i < 2 * RES_PIXEL; ++i) {
+        buf->readByte();
+      }
     }
 
     // Name tables:
@@ -1626,13 +1774,17 @@ void PPU::stateLoad(ByteBuffer* buf) {
       nameTable[i].stateLoad(buf);
     }
 
-    // Pattern data:
+    // Pattern data. The pattern bytes came back with ppuMem, so render
+    // from the local copies until the next bank switch:
     for(size_t i = 0; i < ptTile.size(); ++i) {
       ptTile[i].stateLoad(buf);
     }
+    mapChrBanks(0x0000, KB(8), ppuMem->mem.data(), ptTile.data());
+    ptDirty.reset();
+    ptAnyDirty = false;
 
     // Update internally stored stuff from VRAM memory:
-    /*vector<uint16_t>* mem = ppuMem.mem;
+    /*vector<uint8_t>* mem = ppuMem.mem;
 
     // Palettes:
     for(int i=0x3f00;i<0x3f20;++i) {
@@ -1640,16 +1792,18 @@ void PPU::stateLoad(ByteBuffer* buf) {
     }
     */
     // Sprite data:
-    vector<uint16_t>* sprmem = &(nes->getSprMemory()->mem);
-    for(size_t i = 0; i < sprmem->size(); ++i) {
-      spriteRamWriteUpdate(i, (*sprmem)[i]);
-    }
+    decodeSprites(0);
+    requestSprite0Check(scanline + 1 - vblankAdd - 21);
+
+    // Palettes:
+    palColors = nes->palTable->getTable(f_color, f_dispType);
+    updatePalettes();
   }
 }
 
 void PPU::stateSave(ByteBuffer* buf) {
   // Version:
-  buf->putByte(static_cast<uint16_t>(1));
+  buf->putByte(static_cast<uint8_t>(3));
 
 
   // Counters:
@@ -1684,12 +1838,6 @@ void PPU::stateSave(ByteBuffer* buf) {
   //System.out.println("firstWrite: "+firstWrite);
   buf->putBoolean(firstWrite);
 
-  // Mirroring:
-  //buf->putInt(currentMirroring);
-  for(size_t i = 0; i < vramMirrorTable.size(); ++i) {
-    buf->putInt(vramMirrorTable[i]);
-  }
-
 
   // SPR-RAM I/O:
   buf->putInt(sramAddress);
@@ -1698,7 +1846,6 @@ void PPU::stateSave(ByteBuffer* buf) {
   // Rendering progression:
   buf->putInt(curX);
   buf->putInt(scanline);
-  buf->putInt(lastRenderedScanline);
 
 
   // Misc:
@@ -1709,24 +1856,15 @@ void PPU::stateSave(ByteBuffer* buf) {
   buf->putInt(tmp);
 
 
-  // Stuff used during rendering:
-  for(size_t i = 0; i < bgbuffer.size(); ++i) {
-    buf->putByte(static_cast<uint16_t>(bgbuffer[i]));
-  }
-
-  for(size_t i = 0; i < pixrendered.size(); ++i) {
-    buf->putByte(static_cast<uint16_t>(pixrendered[i]));
-  }
-
   // Name tables:
   for(size_t i = 0; i < 4; ++i) {
-    buf->putByte(static_cast<uint16_t>(ntable1[i]));
+    buf->putByte(static_cast<uint8_t>(ntable1[i]));
     nameTable[i].stateSave(buf);
   }
 
   // Pattern data:
   for(size_t i = 0; i < ptTile.size(); ++i) {
-    ptTile[i].stateSave(buf);
+    patternTile(i).stateSave(buf);
   }
 }
 
@@ -1739,7 +1877,6 @@ void PPU::reset() {
   sramAddress = 0;
   curX = 0;
   scanline = 0;
-  lastRenderedScanline = 0;
   spr0HitX = 0;
   spr0HitY = 0;
   mapperIrqCounter = 0;
@@ -1750,9 +1887,12 @@ void PPU::reset() {
   requestEndFrame = false;
   nmiOk = false;
   hitSpr0 = false;
+  spr0CheckPending = false;
   dummyCycleToggle = false;
   validTileData = false;
   nmiCounter = 0;
+  cycles = 0;
+  nextEventCycles = 0;
   tmp = 0;
   att = 0;
   i = 0;
@@ -1789,6 +1929,9 @@ void PPU::reset() {
   regFH = 0;
   regS = 0;
 
+  // Palette RAM was cleared, so init() must rebuild the palettes:
+  palColors = nullptr;
+
   // Initialize stuff:
   init();
 }
@@ -8,15 +8,14 @@ Hosted at: https://github.com/workhorsy/SaltyNES
 
 #include "SaltyNES.h"
 
-int PaletteTable::curTable[64] = {0};
 int PaletteTable::origTable[64] = {0};
 int PaletteTable::emphTable[8][64] = {{0}};
+int PaletteTable::dispTable[16][64] = {{0}};
 
 PaletteTable::PaletteTable() : enable_shared_from_this<PaletteTable>() {
 }
 
 shared_ptr<PaletteTable> PaletteTable::Init() {
-	currentEmph = -1;
 	currentHue = 0;
 	currentSaturation = 0;
 	currentLightness = 0;
@@ -62,18 +61,11 @@ void PaletteTable::makeTables() {
 	}
 }
 
-void PaletteTable::setEmphasis(int emph) {
-	if(emph != currentEmph) {
-		currentEmph = emph;
-		for(int i = 0; i < 64; ++i) {
-			curTable[i] = emphTable[emph][i];
-		}
-		updatePalette();
-	}
-}
-
-int PaletteTable::getEntry(int yiq) {
-	return curTable[yiq];
+// Returns the 64 colors shown with the emphasis bits and display type
+// of PPU register $2001. The tables are static and rebuilt in place,
+// so the pointer stays valid across palette adjustments.
+const int* PaletteTable::getTable(int emph, int dispType) const {
+	return dispTable[((emph & 7) << 1) | (dispType & 1)];
 }
 
 int PaletteTable::RGBtoHSL(int r, int g, int b) {
@@ -145,6 +137,18 @@ int PaletteTable::getRgb(int r, int g, int b) {
 	return ((r << 16) | (g << 8) | (b));
 }
 
+// Converts color, in the 0x00BBGGRR layout the tables are computed in,
+// to a pixel of the screen texture format.
+int PaletteTable::toPixel(int color) {
+	const int swapped = ((color & 0xFF) << 16) | (color & 0xFF00) | ((color >> 16) & 0xFF);
+	switch(Globals::g_screen_format) {
+		case SDL_PIXELFORMAT_ARGB8888: return static_cast<int>(0xFF000000u | swapped);
+		case SDL_PIXELFORMAT_ABGR8888: return static_cast<int>(0xFF000000u | color);
+		case SDL_PIXELFORMAT_RGB888: return swapped;
+		default: return color;
+	}
+}
+
 void PaletteTable::updatePalette() {
 	updatePalette(currentHue, currentSaturation, currentLightness, currentContrast);
 }
@@ -159,66 +163,75 @@ void PaletteTable::updatePalette(int hueAdd, int saturationAdd, int lightnessAdd
 	if(contrastAdd > 0) {
 		contrastAdd *= 4;
 	}
-	for(int i = 0; i < 64; ++i) {
-
-		hsl = RGBtoHSL(emphTable[currentEmph][i]);
-		h = getHue(hsl) + hueAdd;
-		s = static_cast<int>(getSaturation(hsl) * (1.0 + saturationAdd / 256.0f));
-		l = getLightness(hsl);
-
-		if(h < 0) {
-			h += 255;
-		}
-		if(s < 0) {
-			s = 0;
-		}
-		if(l < 0) {
-			l = 0;
-		}
-
-		if(h > 255) {
-			h -= 255;
-		}
-		if(s > 255) {
-			s = 255;
-		}
-		if(l > 255) {
-			l = 255;
-		}
-
-		rgb = HSLtoRGB(h, s, l);
-
-		r = getRed(rgb);
-		g = getGreen(rgb);
-		b = getBlue(rgb);
+	for(int emph = 0; emph < 8; ++emph) {
+		int* colorTable = dispTable[emph << 1];
+		for(int i = 0; i < 64; ++i) {
 
-		r = 128 + lightnessAdd + static_cast<int>((r - 128) * (1.0 + contrastAdd / 256.0f));
-		g = 128 + lightnessAdd + static_cast<int>((g - 128) * (1.0 + contrastAdd / 256.0f));
-		b = 128 + lightnessAdd + static_cast<int>((b - 128) * (1.0 + contrastAdd / 256.0f));
+			hsl = RGBtoHSL(emphTable[emph][i]);
+			h = getHue(hsl) + hueAdd;
+			s = static_cast<int>(getSaturation(hsl) * (1.0 + saturationAdd / 256.0f));
+			l = getLightness(hsl);
+
+			if(h < 0) {
+				h += 255;
+			}
+			if(s < 0) {
+				s = 0;
+			}
+			if(l < 0) {
+				l = 0;
+			}
+
+			if(h > 255) {
+				h -= 255;
+			}
+			if(s > 255) {
+				s = 255;
+			}
+			if(l > 255) {
+				l = 255;
+			}
+
+			rgb = HSLtoRGB(h, s, l);
+
+			r = getRed(rgb);
+			g = getGreen(rgb);
+			b = getBlue(rgb);
+
+			r = 128 + lightnessAdd + static_cast<int>((r - 128) * (1.0 + contrastAdd / 256.0f));
+			g = 128 + lightnessAdd + static_cast<int>((g - 128) * (1.0 + contrastAdd / 256.0f));
+			b = 128 + lightnessAdd + static_cast<int>((b - 128) * (1.0 + contrastAdd / 256.0f));
+
+			if(r < 0) {
+				r = 0;
+			}
+			if(g < 0) {
+				g = 0;
+			}
+			if(b < 0) {
+				b = 0;
+			}
+
+			if(r > 255) {
+				r = 255;
+			}
+			if(g > 255) {
+				g = 255;
+			}
+			if(b > 255) {
+				b = 255;
+			}
+
+			rgb = getRgb(r, g, b);
+			colorTable[i] = toPixel(rgb);
 
-		if(r < 0) {
-			r = 0;
-		}
-		if(g < 0) {
-			g = 0;
-		}
-		if(b < 0) {
-			b = 0;
 		}
 
-		if(r > 255) {
-			r = 255;
-		}
-		if(g > 255) {
-			g = 255;
-		}
-		if(b > 255) {
-			b = 255;
+		// Monochrome display:
+		int* monoTable = dispTable[(emph << 1) | 1];
+		for(int i = 0; i < 64; ++i) {
+			monoTable[i] = colorTable[i & 32];
 		}
-
-		rgb = getRgb(r, g, b);
-		curTable[i] = rgb;
-
 	}
 
 	currentHue = hueAdd;
@@ -293,15 +306,13 @@ void PaletteTable::loadDefaultPalette() {
 	origTable[62] = getRgb(0, 0, 0);
 	origTable[63] = getRgb(0, 0, 0);
 
-	setEmphasis(0);
 	makeTables();
+	updatePalette();
 }
 
 void PaletteTable::reset() {
-	currentEmph = 0;
 	currentHue = 0;
 	currentSaturation = 0;
 	currentLightness = 0;
-	setEmphasis(0);
 	updatePalette();
 }
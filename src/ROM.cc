@@ -333,7 +333,7 @@ string ROM::getmapperName() {
   return ss.str();
 }
 
-void ROM::load_from_data(const std::string& file_name, vector<uint8_t>* data, array<uint16_t, KB(8)>* save_ram) {
+void ROM::load_from_data(const std::string& file_name, vector<uint8_t>* data, array<uint8_t, KB(8)>* save_ram) {
   fileName = file_name;
   log_to_browser("log: rom::load_from_data");
 
@@ -390,18 +390,14 @@ void ROM::load_from_data(const std::string& file_name, vector<uint8_t>* data, ar
     mapperType &= 0xF;
   }
 
-  rom = vector<array<uint16_t, KB(16)>>(romCount);
+  rom = vector<array<uint8_t, KB(16)>>(romCount);
   for (auto r : rom) { r.fill(0); }
 
-  vrom = vector<array<uint16_t, KB(4)>>(vromCount);
+  vrom = vector<array<uint8_t, KB(4)>>(vromCount);
   for (auto v : vrom) { v.fill(0); }
 
   vromTile = vector<array<Tile, 256>>(vromCount);
-  for (size_t i = 0; i < vromTile.size(); ++i) {
-    for (size_t j = 0; j < vromTile[i].size(); ++j) {
-      vromTile[i][j] = Tile();
-    }
-  }
+  vromTileDecoded = vector<bool>(vromCount, false);
 
   // Load PRG-ROM banks:
   const size_t total_data_cnt = data->size();
@@ -427,28 +423,6 @@ void ROM::load_from_data(const std::string& file_name, vector<uint8_t>* data, ar
     offset += cnt;
   }
 
-  // Create VROM tiles:
-  for(size_t i = 0; i < vromCount; ++i) {
-    for(size_t j = 0; j < 256; ++j) {
-      vromTile[i][j] = Tile();
-    }
-  }
-
-  // Convert CHR-ROM banks to tiles:
-  //System.out.println("Converting CHR-ROM image data..");
-  //System.out.println("VROM bank count: "+vromCount);
-  for (size_t v = 0; v < vromCount; ++v) {
-    for (size_t i = 0; i < KB(4); ++i) {
-      const int tileIndex = (i >> 4);
-      const int leftOver  = (i & 0x0f);
-      if (leftOver < 8) {
-        vromTile[v][tileIndex].setScanline(leftOver, vrom[v][i], vrom[v][i + 8]);
-      } else {
-        vromTile[v][tileIndex].setScanline(leftOver - 8, vrom[v][i - 8], vrom[v][i]);
-      }
-    }
-  }
-
   valid = true;
 }
 
@@ -465,22 +439,36 @@ int ROM::getVromBankCount() {
   return vromCount;
 }
 
-array<uint16_t, 16> ROM::getHeader() {
+array<uint8_t, 16> ROM::getHeader() {
   return header;
 }
 
-array<uint16_t, KB(16)>* ROM::getRomBank(int bank) {
+array<uint8_t, KB(16)>* ROM::getRomBank(int bank) {
   return &(rom[bank]);
 }
 
-array<uint16_t, KB(4)>* ROM::getVromBank(int bank) {
+array<uint8_t, KB(4)>* ROM::getVromBank(int bank) {
   return &(vrom[bank]);
 }
 
 array<Tile, 256>* ROM::getVromBankTiles(int bank) {
+  if (!vromTileDecoded[bank]) {
+    decodeVromBank(bank);
+  }
   return &(vromTile[bank]);
 }
 
+// Converts a CHR-ROM bank to tiles.
+void ROM::decodeVromBank(int bank) {
+  for (size_t tile = 0; tile < 256; ++tile) {
+    for (size_t y = 0; y < 8; ++y) {
+      const size_t i = (tile << 4) + y;
+      vromTile[bank][tile].setScanline(y, vrom[bank][i], vrom[bank][i + 8]);
+    }
+  }
+  vromTileDecoded[bank] = true;
+}
+
 int ROM::getMirroringType() {
   if (fourScreen) {
     return FOURSCREEN_MIRRORING;
@@ -553,7 +541,7 @@ void ROM::setSaveState(bool enableSave) {
   }
 }
 
-array<uint16_t, KB(8)>* ROM::getBatteryRam() {
+array<uint8_t, KB(8)>* ROM::getBatteryRam() {
   return saveRam;
 }
 
@@ -566,7 +554,7 @@ void ROM::loadBatteryRam() {
     saveRamUpToDate = true;
 
     if (saveRam == nullptr) {
-      saveRam = new array<uint16_t, KB(8)>();
+      saveRam = new array<uint8_t, KB(8)>();
       return;
     }
 
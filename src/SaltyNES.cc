@@ -33,7 +33,7 @@ void SaltyNES::init() {
 	nes->reset();
 }
 
-void SaltyNES::load_rom(string rom_name, vector<uint8_t>* rom_data, array<uint16_t, 0x2000>* save_ram) {
+void SaltyNES::load_rom(string rom_name, vector<uint8_t>* rom_data, array<uint8_t, 0x2000>* save_ram) {
 	_rom_name = rom_name;
 	nes->load_rom_from_data(rom_name, rom_data, save_ram);
 }
@@ -20,6 +20,10 @@ Hosted at: https://github.com/workhorsy/SaltyNES
 #include <algorithm>
 #include <memory>
 #include <array>
+#include <atomic>
+#include <bitset>
+#include <cstring>
+#include <utility>
 #include <iterator>
 #include <sys/time.h>
 
@@ -95,6 +99,20 @@ public:
 	virtual int getLengthStatus() = 0;
 };
 
+// Receives every finished frame. Used instead of the SDL texture when headless.
+class IVideoSink {
+public:
+	virtual ~IVideoSink() { }
+	virtual void on_frame(const array<int, RES_PIXEL>& screen) = 0;
+};
+
+// Receives the 16 bit PCM samples written at the end of each frame.
+class IAudioSink {
+public:
+	virtual ~IAudioSink() { }
+	virtual void on_samples(const uint8_t* data, size_t length) = 0;
+};
+
 class Parameters {
 public:
 	static string p1_up;
@@ -123,6 +141,8 @@ public:
 	static SDL_Window* g_window;
 	static SDL_Renderer* g_renderer;
 	static SDL_Texture* g_screen;
+	// Pixel format of g_screen, the palette colors are made in it:
+	static uint32_t g_screen_format;
 
   /* osd resources */
   static TTF_Font* g_osd_font;
@@ -147,11 +167,57 @@ public:
 	static bool palEmulation;
 	static bool enableSound;
   static bool printFps;
+	// Run as fast as possible, without frame pacing:
+	static bool uncapped;
+	// Run straight-line PRG-ROM code as pre-decoded traces:
+	static bool traceCache;
+	// Skip iterations of loops polling $2002 or RAM:
+	static bool idleSkip;
+	// Draw background tile rows 8 pixels at a time with vector code:
+	static bool simdBackground;
+	// Draw at most 8 sprites per scanline, like the hardware:
+	static bool spriteLimit;
+	// Present frames on the main thread while the emulation runs on its own:
+	static bool renderThread;
 
 	static std::map<string, uint32_t> keycodes; //Java key codes
 	static std::map<string, string> controls; //vNES controls codes
 
 	static std::map<int, SDL_Joystick*> joysticks;
+
+	// Headless mode: no window, renderer or audio device.
+	// Frames and samples go to the sinks, and frames are not paced.
+	static bool headless;
+	static IVideoSink* video_sink;
+	static IAudioSink* audio_sink;
+};
+
+// Keeps a copy of the last frame in memory.
+class MemoryVideoSink : public IVideoSink {
+public:
+	MemoryVideoSink();
+	void on_frame(const array<int, RES_PIXEL>& screen) override;
+	const array<int, RES_PIXEL>& last_frame() const { return m_frame; }
+	size_t frame_count() const { return m_frame_count; }
+	uint32_t checksum() const;
+
+private:
+	array<int, RES_PIXEL> m_frame;
+	size_t m_frame_count;
+};
+
+// Keeps the most recent capacity bytes of audio in memory.
+class MemoryAudioSink : public IAudioSink {
+public:
+	explicit MemoryAudioSink(size_t capacity);
+	void on_samples(const uint8_t* data, size_t length) override;
+	const vector<uint8_t>& samples() const { return m_samples; }
+	size_t total_bytes() const { return m_total_bytes; }
+
+private:
+	vector<uint8_t> m_samples;
+	size_t m_capacity;
+	size_t m_total_bytes;
 };
 
 class ByteBuffer {
@@ -159,7 +225,7 @@ public:
 	static const int BO_BIG_ENDIAN = 0;
 	static const int BO_LITTLE_ENDIAN = 1;
 
-	vector<uint16_t> buf;
+	vector<uint8_t> buf;
 	int byteOrder = BO_BIG_ENDIAN;
 	size_t curPos;
 	bool hasBeenErrors;
@@ -189,8 +255,8 @@ public:
 	bool inRange(size_t pos, size_t length);
 	bool putBoolean(bool b);
 	bool putBoolean(bool b, size_t pos);
-	bool putByte(uint16_t var);
-	bool putByte(uint16_t var, size_t pos);
+	bool putByte(uint8_t var);
+	bool putByte(uint8_t var, size_t pos);
 	bool putShort(uint16_t var);
 	bool putShort(uint16_t var, size_t pos);
 	bool putInt(int var);
@@ -203,15 +269,15 @@ public:
 	bool putCharAscii(char var, size_t pos);
 	bool putStringAscii(string var);
 	bool putStringAscii(string var, size_t pos);
-	bool putByteArray(vector<uint16_t>* arr);
-	bool readByteArray(vector<uint16_t>* arr);
+	bool putByteArray(vector<uint8_t>* arr);
+	bool readByteArray(vector<uint8_t>* arr);
 	bool putShortArray(vector<uint16_t>* arr);
 	string toString();
 	string toStringAscii();
 	bool readBoolean();
 	bool readBoolean(size_t pos);
-	uint16_t readByte();
-	uint16_t readByte(size_t pos);
+	uint8_t readByte();
+	uint8_t readByte(size_t pos);
 	uint16_t readShort();
 	uint16_t readShort(size_t pos);
 	int readInt();
@@ -391,38 +457,145 @@ public:
 	void reset();
 };
 
+// Traces of pre-decoded instructions in the PRG-ROM window ($8000-$FFFF).
+// A trace is the straight-line code from an address up to and including
+// the next branch, jump, call or return, so the CPU can run it as one
+// unit. Each 8K bank slot has a generation. Swapping a slot bumps it,
+// which drops every trace decoded in that slot.
+class TraceCache {
+public:
+	struct Op {
+		uint16_t operand;
+		// Most CPU cycles the trace can take up to and including this op,
+		// with page crosses and taken branches:
+		uint16_t maxCycles;
+		uint8_t opcode;
+	};
+
+	static const int MAX_OPS = 16;
+
+	struct Trace {
+		uint8_t length;
+		array<Op, MAX_OPS> ops;
+
+		uint16_t maxCycles() const { return ops[length - 1].maxCycles; }
+		// Number of leading ops that surely end within cycles:
+		int fit(int cycles) const {
+			int n = 0;
+			while (n < length && ops[n].maxCycles <= cycles) {
+				++n;
+			}
+			return n;
+		}
+	};
+
+	static const int BASE = 0x8000;
+	static const int SLOT_SIZE = KB(8);
+
+	TraceCache();
+	const Trace* lookup(int address, MapperDefault* mapper);
+	void invalidate(int address, int length);
+	void clear();
+
+	uint64_t hits() const { return m_hits; }
+	uint64_t decodes() const { return m_decodes; }
+	uint64_t invalidations() const { return m_invalidations; }
+
+private:
+	struct Entry {
+		uint32_t gen;
+		uint16_t trace;
+	};
+
+	bool decode(int address, MapperDefault* mapper, Trace* trace);
+
+	vector<Entry> m_entries;
+	array<vector<Trace>, 4> m_traces;
+	array<uint32_t, 4> m_gen;
+	uint64_t m_hits;
+	uint64_t m_decodes;
+	uint64_t m_invalidations;
+};
+
+// Hands finished frames from the emulation thread to the presentation
+// thread without locks. The emulation draws into the back buffer and
+// publishes it by swapping it with the middle one. The presenter swaps
+// its front buffer with the middle one when that holds a new frame. So
+// neither side ever waits, and the presenter shows the newest frame.
+class TripleBuffer {
+public:
+	typedef array<int, RES_PIXEL> Frame;
+
+	TripleBuffer();
+	Frame* back() { return &m_frames[m_back]; }
+	Frame* publish();
+	const Frame* consume();
+
+	// Frames published again before the presenter took them:
+	uint64_t dropped() const { return m_dropped; }
+
+private:
+	// Set in m_middle when it holds a frame the presenter has not taken:
+	static const uint8_t FRESH = 4;
+
+	array<Frame, 3> m_frames;
+	atomic<uint8_t> m_middle;
+	uint8_t m_back;
+	uint8_t m_front;
+	uint64_t m_dropped;
+};
+
 class CPU : public enable_shared_from_this<CPU> {
 private:
   void handle_irq();
   int calculate_addr(const int addr_mode);
-  bool exec_inst();
+  bool exec_inst(const int inst, const int addr_mode);
+  bool exec_opcode(const int z);
+  bool step_inst();
+  bool run_trace(const TraceCache::Trace& trace, int length);
+  int operand8();
+  int operand16();
+  void skip_idle_loop();
+#ifdef CPU_DISPATCH_TABLE
+  // One handler per opcode, specialized at compile time from CpuInfo::opInfo:
+  typedef bool (*OpHandler)(CPU* cpu);
+  static const array<OpHandler, 256> op_handlers;
+  template <int OP> static bool exec_op(CPU* cpu);
+  template <size_t... OPS> static constexpr array<OpHandler, 256> make_op_handlers(index_sequence<OPS...>);
+#endif
 public:
 	// IRQ Types:
 	static const int IRQ_NORMAL = 0;
 	static const int IRQ_NMI	= 1;
 	static const int IRQ_RESET  = 2;
 
-	// References to other parts of NES :
+	// References to other parts of NES.
+	// The NES owns them. The raw pointers are bound by init() and
+	// setMapper(), so emulate() never copies a shared_ptr:
 	shared_ptr<NES> nes;
-	shared_ptr<MapperDefault> mmap;
-	vector<uint16_t>* mem;
+	MapperDefault* mmap;
+	PPU* ppu;
+	PAPU* papu;
+	vector<uint8_t>* mem;
 
 	// Registers:
-	int REG_ACC;
-	int REG_X;
-	int REG_Y;
-	int REG_STATUS;
+	uint8_t REG_ACC;
+	uint8_t REG_X;
+	uint8_t REG_Y;
 	int REG_PC;
+	int REG_SP;
 
-	// Status flags:
-	int F_CARRY;
-	int F_ZERO;
-	int F_INTERRUPT;
-	int F_DECIMAL;
-	int F_NOTUSED;
-	int F_BRK;
-	int F_OVERFLOW;
-	int F_SIGN;
+	// Status flags, one byte each. They are only packed into
+	// the P register when it is pushed or saved. F_ZERO holds
+	// the last result, the zero flag is set when it is 0:
+	uint8_t F_CARRY;
+	uint8_t F_ZERO;
+	uint8_t F_INTERRUPT;
+	uint8_t F_DECIMAL;
+	uint8_t F_NOTUSED;
+	uint8_t F_BRK;
+	uint8_t F_OVERFLOW;
+	uint8_t F_SIGN;
 
   void status_reg(const int temp) {
     F_CARRY     = (temp   ) & 1;
@@ -458,33 +631,33 @@ public:
 	int temp;
 	int add;
 
-	// CPU Registers:
-	int REG_ACC_NEW;
-	int REG_X_NEW;
-	int REG_Y_NEW;
-	int REG_STATUS_NEW;
-	int REG_PC_NEW;
-	int REG_SP;
-
-	// Status flags:
-	int F_CARRY_NEW;
-	int F_ZERO_NEW;
-	int F_INTERRUPT_NEW;
-	int F_DECIMAL_NEW;
-	int F_BRK_NEW;
-	int F_NOTUSED_NEW;
-	int F_OVERFLOW_NEW;
-	int F_SIGN_NEW;
-
 	// Interrupt notification:
 	bool irqRequested;
 	int irqType;
 
 	// Misc vars:
 	int cyclesToHalt;
-	bool stopRunning;
+	atomic<bool> stopRunning;
 	bool crash;
 
+	// Throughput counters:
+	uint64_t totalInstructions;
+
+	// Polling loops skipped by skip_idle_loop:
+	uint64_t idleSkips;
+	uint64_t idleSkippedInstructions;
+	uint64_t idleSkippedCycles;
+
+	// Run PRG-ROM code as traces, when Globals::traceCache is on.
+	// decoded is true while the current instruction came from a trace.
+	// ioAccessed is set by loads and writes that leave RAM and ROM:
+	TraceCache trace;
+	bool decoded;
+	int decodedOperand;
+	bool ioAccessed;
+	uint64_t traceRuns;
+	uint64_t tracedInstructions;
+
 	explicit CPU();
 	shared_ptr<CPU> Init(shared_ptr<NES> nes);
 	~CPU();
@@ -517,8 +690,7 @@ public:
 class CpuInfo {
 public:
 	// Opdata array:
-	static bool isOp;
-	static array<int, 256> opdata;
+	static const array<int, 256> opdata;
 	// Instruction names:
 	static const array<string, 56> instname;
 	// Address mode descriptions:
@@ -526,87 +698,365 @@ public:
 	static const array<int, 256> cycTable;
 	// Instruction types:
 	// -------------------------------- //
-	static const int INS_ADC;
-	static const int INS_AND;
-	static const int INS_ASL;
-	static const int INS_BCC;
-	static const int INS_BCS;
-	static const int INS_BEQ;
-	static const int INS_BIT;
-	static const int INS_BMI;
-	static const int INS_BNE;
-	static const int INS_BPL;
-	static const int INS_BRK;
-	static const int INS_BVC;
-	static const int INS_BVS;
-	static const int INS_CLC;
-	static const int INS_CLD;
-	static const int INS_CLI;
-	static const int INS_CLV;
-	static const int INS_CMP;
-	static const int INS_CPX;
-	static const int INS_CPY;
-	static const int INS_DEC;
-	static const int INS_DEX;
-	static const int INS_DEY;
-	static const int INS_EOR;
-	static const int INS_INC;
-	static const int INS_INX;
-	static const int INS_INY;
-	static const int INS_JMP;
-	static const int INS_JSR;
-	static const int INS_LDA;
-	static const int INS_LDX;
-	static const int INS_LDY;
-	static const int INS_LSR;
-	static const int INS_NOP;
-	static const int INS_ORA;
-	static const int INS_PHA;
-	static const int INS_PHP;
-	static const int INS_PLA;
-	static const int INS_PLP;
-	static const int INS_ROL;
-	static const int INS_ROR;
-	static const int INS_RTI;
-	static const int INS_RTS;
-	static const int INS_SBC;
-	static const int INS_SEC;
-	static const int INS_SED;
-	static const int INS_SEI;
-	static const int INS_STA;
-	static const int INS_STX;
-	static const int INS_STY;
-	static const int INS_TAX;
-	static const int INS_TAY;
-	static const int INS_TSX;
-	static const int INS_TXA;
-	static const int INS_TXS;
-	static const int INS_TYA;
-	static const int INS_DUMMY; // dummy instruction used for 'halting' the processor some cycles
+	static const int INS_ADC = 0;
+	static const int INS_AND = 1;
+	static const int INS_ASL = 2;
+	static const int INS_BCC = 3;
+	static const int INS_BCS = 4;
+	static const int INS_BEQ = 5;
+	static const int INS_BIT = 6;
+	static const int INS_BMI = 7;
+	static const int INS_BNE = 8;
+	static const int INS_BPL = 9;
+	static const int INS_BRK = 10;
+	static const int INS_BVC = 11;
+	static const int INS_BVS = 12;
+	static const int INS_CLC = 13;
+	static const int INS_CLD = 14;
+	static const int INS_CLI = 15;
+	static const int INS_CLV = 16;
+	static const int INS_CMP = 17;
+	static const int INS_CPX = 18;
+	static const int INS_CPY = 19;
+	static const int INS_DEC = 20;
+	static const int INS_DEX = 21;
+	static const int INS_DEY = 22;
+	static const int INS_EOR = 23;
+	static const int INS_INC = 24;
+	static const int INS_INX = 25;
+	static const int INS_INY = 26;
+	static const int INS_JMP = 27;
+	static const int INS_JSR = 28;
+	static const int INS_LDA = 29;
+	static const int INS_LDX = 30;
+	static const int INS_LDY = 31;
+	static const int INS_LSR = 32;
+	static const int INS_NOP = 33;
+	static const int INS_ORA = 34;
+	static const int INS_PHA = 35;
+	static const int INS_PHP = 36;
+	static const int INS_PLA = 37;
+	static const int INS_PLP = 38;
+	static const int INS_ROL = 39;
+	static const int INS_ROR = 40;
+	static const int INS_RTI = 41;
+	static const int INS_RTS = 42;
+	static const int INS_SBC = 43;
+	static const int INS_SEC = 44;
+	static const int INS_SED = 45;
+	static const int INS_SEI = 46;
+	static const int INS_STA = 47;
+	static const int INS_STX = 48;
+	static const int INS_STY = 49;
+	static const int INS_TAX = 50;
+	static const int INS_TAY = 51;
+	static const int INS_TSX = 52;
+	static const int INS_TXA = 53;
+	static const int INS_TXS = 54;
+	static const int INS_TYA = 55;
+	static const int INS_DUMMY = 56; // dummy instruction used for 'halting' the processor some cycles
 	// -------------------------------- //
 	// Addressing modes:
-	static const int ADDR_ZP;
-	static const int ADDR_REL;
-	static const int ADDR_IMP;
-	static const int ADDR_ABS;
-	static const int ADDR_ACC;
-	static const int ADDR_IMM;
-	static const int ADDR_ZPX;
-	static const int ADDR_ZPY;
-	static const int ADDR_ABSX;
-	static const int ADDR_ABSY;
-	static const int ADDR_PREIDXIND;
-	static const int ADDR_POSTIDXIND;
-	static const int ADDR_INDABS;
+	static const int ADDR_ZP = 0;
+	static const int ADDR_REL = 1;
+	static const int ADDR_IMP = 2;
+	static const int ADDR_ABS = 3;
+	static const int ADDR_ACC = 4;
+	static const int ADDR_IMM = 5;
+	static const int ADDR_ZPX = 6;
+	static const int ADDR_ZPY = 7;
+	static const int ADDR_ABSX = 8;
+	static const int ADDR_ABSY = 9;
+	static const int ADDR_PREIDXIND = 10;
+	static const int ADDR_POSTIDXIND = 11;
+	static const int ADDR_INDABS = 12;
 
 	static array<string, 56> getInstNames();
 	static string getInstName(size_t inst);
 	static array<string, 13> getAddressModeNames();
 	static string getAddressModeName(int addrMode);
-	static void initOpData();
-	static void setOp(int inst, int op, int addr, int size, int cycles);
+	static constexpr int opInfo(int op);
+	static constexpr int setOp(int inst, int addr, int size, int cycles) {
+		return
+			((inst & 0xFF)) |
+			((addr & 0xFF) << 8) |
+			((size & 0xFF) << 16) |
+			((cycles & 0xFF) << 24);
+	}
 };
 
+// Instruction, address mode, size and cycles of an opcode.
+// It is constexpr, so the CPU can specialize a handler per opcode:
+constexpr int CpuInfo::opInfo(int op) {
+	switch (op) {
+		// ADC:
+		case 0x69: return setOp(INS_ADC, ADDR_IMM, 2, 2);
+		case 0x65: return setOp(INS_ADC, ADDR_ZP, 2, 3);
+		case 0x75: return setOp(INS_ADC, ADDR_ZPX, 2, 4);
+		case 0x6D: return setOp(INS_ADC, ADDR_ABS, 3, 4);
+		case 0x7D: return setOp(INS_ADC, ADDR_ABSX, 3, 4);
+		case 0x79: return setOp(INS_ADC, ADDR_ABSY, 3, 4);
+		case 0x61: return setOp(INS_ADC, ADDR_PREIDXIND, 2, 6);
+		case 0x71: return setOp(INS_ADC, ADDR_POSTIDXIND, 2, 5);
+
+		// AND:
+		case 0x29: return setOp(INS_AND, ADDR_IMM, 2, 2);
+		case 0x25: return setOp(INS_AND, ADDR_ZP, 2, 3);
+		case 0x35: return setOp(INS_AND, ADDR_ZPX, 2, 4);
+		case 0x2D: return setOp(INS_AND, ADDR_ABS, 3, 4);
+		case 0x3D: return setOp(INS_AND, ADDR_ABSX, 3, 4);
+		case 0x39: return setOp(INS_AND, ADDR_ABSY, 3, 4);
+		case 0x21: return setOp(INS_AND, ADDR_PREIDXIND, 2, 6);
+		case 0x31: return setOp(INS_AND, ADDR_POSTIDXIND, 2, 5);
+
+		// ASL:
+		case 0x0A: return setOp(INS_ASL, ADDR_ACC, 1, 2);
+		case 0x06: return setOp(INS_ASL, ADDR_ZP, 2, 5);
+		case 0x16: return setOp(INS_ASL, ADDR_ZPX, 2, 6);
+		case 0x0E: return setOp(INS_ASL, ADDR_ABS, 3, 6);
+		case 0x1E: return setOp(INS_ASL, ADDR_ABSX, 3, 7);
+
+		// BCC:
+		case 0x90: return setOp(INS_BCC, ADDR_REL, 2, 2);
+
+		// BCS:
+		case 0xB0: return setOp(INS_BCS, ADDR_REL, 2, 2);
+
+		// BEQ:
+		case 0xF0: return setOp(INS_BEQ, ADDR_REL, 2, 2);
+
+		// BIT:
+		case 0x24: return setOp(INS_BIT, ADDR_ZP, 2, 3);
+		case 0x2C: return setOp(INS_BIT, ADDR_ABS, 3, 4);
+
+		// BMI:
+		case 0x30: return setOp(INS_BMI, ADDR_REL, 2, 2);
+
+		// BNE:
+		case 0xD0: return setOp(INS_BNE, ADDR_REL, 2, 2);
+
+		// BPL:
+		case 0x10: return setOp(INS_BPL, ADDR_REL, 2, 2);
+
+		// BRK:
+		case 0x00: return setOp(INS_BRK, ADDR_IMP, 1, 7);
+
+		// BVC:
+		case 0x50: return setOp(INS_BVC, ADDR_REL, 2, 2);
+
+		// BVS:
+		case 0x70: return setOp(INS_BVS, ADDR_REL, 2, 2);
+
+		// CLC:
+		case 0x18: return setOp(INS_CLC, ADDR_IMP, 1, 2);
+
+		// CLD:
+		case 0xD8: return setOp(INS_CLD, ADDR_IMP, 1, 2);
+
+		// CLI:
+		case 0x58: return setOp(INS_CLI, ADDR_IMP, 1, 2);
+
+		// CLV:
+		case 0xB8: return setOp(INS_CLV, ADDR_IMP, 1, 2);
+
+		// CMP:
+		case 0xC9: return setOp(INS_CMP, ADDR_IMM, 2, 2);
+		case 0xC5: return setOp(INS_CMP, ADDR_ZP, 2, 3);
+		case 0xD5: return setOp(INS_CMP, ADDR_ZPX, 2, 4);
+		case 0xCD: return setOp(INS_CMP, ADDR_ABS, 3, 4);
+		case 0xDD: return setOp(INS_CMP, ADDR_ABSX, 3, 4);
+		case 0xD9: return setOp(INS_CMP, ADDR_ABSY, 3, 4);
+		case 0xC1: return setOp(INS_CMP, ADDR_PREIDXIND, 2, 6);
+		case 0xD1: return setOp(INS_CMP, ADDR_POSTIDXIND, 2, 5);
+
+		// CPX:
+		case 0xE0: return setOp(INS_CPX, ADDR_IMM, 2, 2);
+		case 0xE4: return setOp(INS_CPX, ADDR_ZP, 2, 3);
+		case 0xEC: return setOp(INS_CPX, ADDR_ABS, 3, 4);
+
+		// CPY:
+		case 0xC0: return setOp(INS_CPY, ADDR_IMM, 2, 2);
+		case 0xC4: return setOp(INS_CPY, ADDR_ZP, 2, 3);
+		case 0xCC: return setOp(INS_CPY, ADDR_ABS, 3, 4);
+
+		// DEC:
+		case 0xC6: return setOp(INS_DEC, ADDR_ZP, 2, 5);
+		case 0xD6: return setOp(INS_DEC, ADDR_ZPX, 2, 6);
+		case 0xCE: return setOp(INS_DEC, ADDR_ABS, 3, 6);
+		case 0xDE: return setOp(INS_DEC, ADDR_ABSX, 3, 7);
+
+		// DEX:
+		case 0xCA: return setOp(INS_DEX, ADDR_IMP, 1, 2);
+
+		// DEY:
+		case 0x88: return setOp(INS_DEY, ADDR_IMP, 1, 2);
+
+		// EOR:
+		case 0x49: return setOp(INS_EOR, ADDR_IMM, 2, 2);
+		case 0x45: return setOp(INS_EOR, ADDR_ZP, 2, 3);
+		case 0x55: return setOp(INS_EOR, ADDR_ZPX, 2, 4);
+		case 0x4D: return setOp(INS_EOR, ADDR_ABS, 3, 4);
+		case 0x5D: return setOp(INS_EOR, ADDR_ABSX, 3, 4);
+		case 0x59: return setOp(INS_EOR, ADDR_ABSY, 3, 4);
+		case 0x41: return setOp(INS_EOR, ADDR_PREIDXIND, 2, 6);
+		case 0x51: return setOp(INS_EOR, ADDR_POSTIDXIND, 2, 5);
+
+		// INC:
+		case 0xE6: return setOp(INS_INC, ADDR_ZP, 2, 5);
+		case 0xF6: return setOp(INS_INC, ADDR_ZPX, 2, 6);
+		case 0xEE: return setOp(INS_INC, ADDR_ABS, 3, 6);
+		case 0xFE: return setOp(INS_INC, ADDR_ABSX, 3, 7);
+
+		// INX:
+		case 0xE8: return setOp(INS_INX, ADDR_IMP, 1, 2);
+
+		// INY:
+		case 0xC8: return setOp(INS_INY, ADDR_IMP, 1, 2);
+
+		// JMP:
+		case 0x4C: return setOp(INS_JMP, ADDR_ABS, 3, 3);
+		case 0x6C: return setOp(INS_JMP, ADDR_INDABS, 3, 5);
+
+		// JSR:
+		case 0x20: return setOp(INS_JSR, ADDR_ABS, 3, 6);
+
+		// LDA:
+		case 0xA9: return setOp(INS_LDA, ADDR_IMM, 2, 2);
+		case 0xA5: return setOp(INS_LDA, ADDR_ZP, 2, 3);
+		case 0xB5: return setOp(INS_LDA, ADDR_ZPX, 2, 4);
+		case 0xAD: return setOp(INS_LDA, ADDR_ABS, 3, 4);
+		case 0xBD: return setOp(INS_LDA, ADDR_ABSX, 3, 4);
+		case 0xB9: return setOp(INS_LDA, ADDR_ABSY, 3, 4);
+		case 0xA1: return setOp(INS_LDA, ADDR_PREIDXIND, 2, 6);
+		case 0xB1: return setOp(INS_LDA, ADDR_POSTIDXIND, 2, 5);
+
+		// LDX:
+		case 0xA2: return setOp(INS_LDX, ADDR_IMM, 2, 2);
+		case 0xA6: return setOp(INS_LDX, ADDR_ZP, 2, 3);
+		case 0xB6: return setOp(INS_LDX, ADDR_ZPY, 2, 4);
+		case 0xAE: return setOp(INS_LDX, ADDR_ABS, 3, 4);
+		case 0xBE: return setOp(INS_LDX, ADDR_ABSY, 3, 4);
+
+		// LDY:
+		case 0xA0: return setOp(INS_LDY, ADDR_IMM, 2, 2);
+		case 0xA4: return setOp(INS_LDY, ADDR_ZP, 2, 3);
+		case 0xB4: return setOp(INS_LDY, ADDR_ZPX, 2, 4);
+		case 0xAC: return setOp(INS_LDY, ADDR_ABS, 3, 4);
+		case 0xBC: return setOp(INS_LDY, ADDR_ABSX, 3, 4);
+
+		// LSR:
+		case 0x4A: return setOp(INS_LSR, ADDR_ACC, 1, 2);
+		case 0x46: return setOp(INS_LSR, ADDR_ZP, 2, 5);
+		case 0x56: return setOp(INS_LSR, ADDR_ZPX, 2, 6);
+		case 0x4E: return setOp(INS_LSR, ADDR_ABS, 3, 6);
+		case 0x5E: return setOp(INS_LSR, ADDR_ABSX, 3, 7);
+
+		// NOP:
+		case 0xEA: return setOp(INS_NOP, ADDR_IMP, 1, 2);
+
+		// ORA:
+		case 0x09: return setOp(INS_ORA, ADDR_IMM, 2, 2);
+		case 0x05: return setOp(INS_ORA, ADDR_ZP, 2, 3);
+		case 0x15: return setOp(INS_ORA, ADDR_ZPX, 2, 4);
+		case 0x0D: return setOp(INS_ORA, ADDR_ABS, 3, 4);
+		case 0x1D: return setOp(INS_ORA, ADDR_ABSX, 3, 4);
+		case 0x19: return setOp(INS_ORA, ADDR_ABSY, 3, 4);
+		case 0x01: return setOp(INS_ORA, ADDR_PREIDXIND, 2, 6);
+		case 0x11: return setOp(INS_ORA, ADDR_POSTIDXIND, 2, 5);
+
+		// PHA:
+		case 0x48: return setOp(INS_PHA, ADDR_IMP, 1, 3);
+
+		// PHP:
+		case 0x08: return setOp(INS_PHP, ADDR_IMP, 1, 3);
+
+		// PLA:
+		case 0x68: return setOp(INS_PLA, ADDR_IMP, 1, 4);
+
+		// PLP:
+		case 0x28: return setOp(INS_PLP, ADDR_IMP, 1, 4);
+
+		// ROL:
+		case 0x2A: return setOp(INS_ROL, ADDR_ACC, 1, 2);
+		case 0x26: return setOp(INS_ROL, ADDR_ZP, 2, 5);
+		case 0x36: return setOp(INS_ROL, ADDR_ZPX, 2, 6);
+		case 0x2E: return setOp(INS_ROL, ADDR_ABS, 3, 6);
+		case 0x3E: return setOp(INS_ROL, ADDR_ABSX, 3, 7);
+
+		// ROR:
+		case 0x6A: return setOp(INS_ROR, ADDR_ACC, 1, 2);
+		case 0x66: return setOp(INS_ROR, ADDR_ZP, 2, 5);
+		case 0x76: return setOp(INS_ROR, ADDR_ZPX, 2, 6);
+		case 0x6E: return setOp(INS_ROR, ADDR_ABS, 3, 6);
+		case 0x7E: return setOp(INS_ROR, ADDR_ABSX, 3, 7);
+
+		// RTI:
+		case 0x40: return setOp(INS_RTI, ADDR_IMP, 1, 6);
+
+		// RTS:
+		case 0x60: return setOp(INS_RTS, ADDR_IMP, 1, 6);
+
+		// SBC:
+		case 0xE9: return setOp(INS_SBC, ADDR_IMM, 2, 2);
+		case 0xE5: return setOp(INS_SBC, ADDR_ZP, 2, 3);
+		case 0xF5: return setOp(INS_SBC, ADDR_ZPX, 2, 4);
+		case 0xED: return setOp(INS_SBC, ADDR_ABS, 3, 4);
+		case 0xFD: return setOp(INS_SBC, ADDR_ABSX, 3, 4);
+		case 0xF9: return setOp(INS_SBC, ADDR_ABSY, 3, 4);
+		case 0xE1: return setOp(INS_SBC, ADDR_PREIDXIND, 2, 6);
+		case 0xF1: return setOp(INS_SBC, ADDR_POSTIDXIND, 2, 5);
+
+		// SEC:
+		case 0x38: return setOp(INS_SEC, ADDR_IMP, 1, 2);
+
+		// SED:
+		case 0xF8: return setOp(INS_SED, ADDR_IMP, 1, 2);
+
+		// SEI:
+		case 0x78: return setOp(INS_SEI, ADDR_IMP, 1, 2);
+
+		// STA:
+		case 0x85: return setOp(INS_STA, ADDR_ZP, 2, 3);
+		case 0x95: return setOp(INS_STA, ADDR_ZPX, 2, 4);
+		case 0x8D: return setOp(INS_STA, ADDR_ABS, 3, 4);
+		case 0x9D: return setOp(INS_STA, ADDR_ABSX, 3, 5);
+		case 0x99: return setOp(INS_STA, ADDR_ABSY, 3, 5);
+		case 0x81: return setOp(INS_STA, ADDR_PREIDXIND, 2, 6);
+		case 0x91: return setOp(INS_STA, ADDR_POSTIDXIND, 2, 6);
+
+		// STX:
+		case 0x86: return setOp(INS_STX, ADDR_ZP, 2, 3);
+		case 0x96: return setOp(INS_STX, ADDR_ZPY, 2, 4);
+		case 0x8E: return setOp(INS_STX, ADDR_ABS, 3, 4);
+
+		// STY:
+		case 0x84: return setOp(INS_STY, ADDR_ZP, 2, 3);
+		case 0x94: return setOp(INS_STY, ADDR_ZPX, 2, 4);
+		case 0x8C: return setOp(INS_STY, ADDR_ABS, 3, 4);
+
+		// TAX:
+		case 0xAA: return setOp(INS_TAX, ADDR_IMP, 1, 2);
+
+		// TAY:
+		case 0xA8: return setOp(INS_TAY, ADDR_IMP, 1, 2);
+
+		// TSX:
+		case 0xBA: return setOp(INS_TSX, ADDR_IMP, 1, 2);
+
+		// TXA:
+		case 0x8A: return setOp(INS_TXA, ADDR_IMP, 1, 2);
+
+		// TXS:
+		case 0x9A: return setOp(INS_TXS, ADDR_IMP, 1, 2);
+
+		// TYA:
+		case 0x98: return setOp(INS_TYA, ADDR_IMP, 1, 2);
+
+		// Invalid instruction (to detect crashes):
+		default: return 0xFF;
+	}
+}
+
 // interface to register additional key mapping and handling
 // it will be copied into InputHandler
 class UserKeyHandlerIntf {
@@ -646,6 +1096,8 @@ private:
 	int _id;
 	vector<bool> _keys;
 	vector<int> _map;
+	// One bit per joypad key, read by the emulation while another thread polls:
+	atomic<uint32_t> _pad_state{0};
 
 	bool _is_keyboard_used;
 	std::vector<bool> _is_input_pressed;
@@ -674,7 +1126,7 @@ public:
 class Memory : public enable_shared_from_this<Memory> {
 public:
 	shared_ptr<NES> nes;
-	vector<uint16_t> mem;
+	vector<uint8_t> mem;
 
 	Memory();
 	shared_ptr<Memory> Init(shared_ptr<NES> nes, size_t byteCount);
@@ -683,12 +1135,12 @@ public:
 	void stateSave(ByteBuffer* buf);
 	void reset();
 	size_t getMemSize();
-	void write(size_t address, uint16_t value);
-	uint16_t load(size_t address);
+	void write(size_t address, uint8_t value);
+	uint8_t load(size_t address);
 	void dump(string file);
 	void dump(string file, size_t offset, size_t length);
-	void write(size_t address, array<uint16_t, 16384>* array, size_t length);
-	void write(size_t address, array<uint16_t, 16384>* array, size_t arrayoffset, size_t length);
+	void write(size_t address, array<uint8_t, 16384>* array, size_t length);
+	void write(size_t address, array<uint8_t, 16384>* array, size_t arrayoffset, size_t length);
 };
 
 class MapperDefault : public enable_shared_from_this<MapperDefault> {
@@ -696,10 +1148,11 @@ public:
 	shared_ptr<NES> nes;
 	shared_ptr<Memory> cpuMem;
 	shared_ptr<Memory> ppuMem;
-	vector<uint16_t>* cpuMemArray;
+	vector<uint8_t>* cpuMemArray;
 	shared_ptr<ROM> rom;
 	shared_ptr<CPU> cpu;
 	shared_ptr<PPU> ppu;
+	shared_ptr<PAPU> papu;
 	int cpuMemSize;
 	int joy1StrobeState;
 	int joy2StrobeState;
@@ -710,6 +1163,11 @@ public:
 	int mouseY;
 	int tmp;
 
+	// CPU memory map in 256 byte pages. Pages without a pointer go
+	// through load() and write() instead:
+	array<const uint8_t*, 256> readPage;
+	array<uint8_t*, 256> writePage;
+
 	MapperDefault();
 	shared_ptr<MapperDefault> Init(shared_ptr<NES> nes);
 	virtual ~MapperDefault();
@@ -740,6 +1198,8 @@ public:
 	void load1kVromBank(int bank1k, int address);
 	void load2kVromBank(int bank2k, int address);
 	void load8kRomBank(int bank8k, int address);
+	void mapReadPages(int address, int length, const uint8_t* data);
+	void syncPrgMemory();
 	virtual void clockIrqCounter();
 	void latchAccess(int address);
 	int syncV();
@@ -836,12 +1296,12 @@ class Mapper007 : public MapperDefault {
 public:
 	int currentOffset;
 	int currentMirroring;
-	vector<uint16_t> prgrom;
 
 	Mapper007();
 	virtual shared_ptr<MapperDefault> Init(shared_ptr<NES> nes);
-	virtual uint16_t load(int address);
 	virtual void write(int address, uint16_t value);
+	virtual void loadROM(shared_ptr<ROM> rom);
+	void loadPrgBank();
 	void mapperInternalStateLoad(ByteBuffer* buf);
 	void mapperInternalStateSave(ByteBuffer* buf);
 	virtual void reset();
@@ -937,8 +1397,8 @@ public:
 	static string binStr(uint32_t value, int bitcount);
 	static string pad(string str, string padStr, int length);
 	static float random();
-	static string from_vector_to_hex_string(array<uint16_t, 0x2000>* data);
-	static vector<uint16_t>* from_hex_string_to_vector(string data);
+	static string from_vector_to_hex_string(array<uint8_t, 0x2000>* data);
+	static vector<uint8_t>* from_hex_string_to_vector(string data);
 };
 
 class NameTable {
@@ -997,7 +1457,7 @@ public:
 	shared_ptr<Memory> getSprMemory();
 	shared_ptr<ROM> getRom();
 	shared_ptr<MapperDefault> getMemoryMapper();
-	bool load_rom_from_data(string rom_name, vector<uint8_t>* data, array<uint16_t, 0x2000>* save_ram);
+	bool load_rom_from_data(string rom_name, vector<uint8_t>* data, array<uint8_t, 0x2000>* save_ram);
 	void reset();
 	void enableSound(bool enable);
 //	void setFramerate(int rate);
@@ -1005,19 +1465,18 @@ public:
 
 class PaletteTable : public enable_shared_from_this<PaletteTable> {
 public:
-	static int curTable[64];
 	static int origTable[64];
 	static int emphTable[8][64];
+	// Adjusted colors for every emphasis and display type, see getTable:
+	static int dispTable[16][64];
 
-	int currentEmph;
 	int currentHue, currentSaturation, currentLightness, currentContrast;
 
 	PaletteTable();
 	shared_ptr<PaletteTable> Init();
 	bool loadNTSCPalette();
 	void makeTables();
-	void setEmphasis(int emph);
-	int getEntry(int yiq);
+	const int* getTable(int emph, int dispType) const;
 	int RGBtoHSL(int r, int g, int b);
 	int RGBtoHSL(int rgb);
 	int HSLtoRGB(int h, int s, int l);
@@ -1032,6 +1491,7 @@ public:
 	static void setGreen(int* rgb, int g);
 	static void setBlue(int* rgb, int b);
 	int getRgb(int r, int g, int b);
+	static int toPixel(int color);
 	void updatePalette();
 	void updatePalette(int hueAdd, int saturationAdd, int lightnessAdd, int contrastAdd);
 	void loadDefaultPalette();
@@ -1161,65 +1621,76 @@ public:
 class Tile {
 public:
 	Tile();
-	void setBuffer(vector<uint16_t>* scanline);
+	void setBuffer(vector<uint8_t>* scanline);
 	void setScanline(int sline, uint16_t b1, uint16_t b2);
-	void renderSimple(int dx, int dy, vector<int>* fBuffer, int palAdd, int* palette);
-	void renderSmall(int dx, int dy, vector<int>* buffer, int palAdd, int* palette);
-	void render(int srcx1, int srcy1, int srcx2, int srcy2, int dx, int dy, array<int, RES_PIXEL>* fBuffer, int palAdd, array<int, 16>* palette, bool flipHorizontal, bool flipVertical, int pri, array<int, RES_PIXEL>* priTable);
-	bool isTransparent(int x, int y);
-	void dumpData(string file);
-	void stateSave(ByteBuffer* buf);
+	void renderSimple(int dx, int dy, vector<int>* fBuffer, int palAdd, int* palette) const;
+	void renderSmall(int dx, int dy, vector<int>* buffer, int palAdd, int* palette) const;
+	bool isTransparent(int x, int y) const;
+	void dumpData(string file) const;
+	void stateSave(ByteBuffer* buf) const;
 	void stateLoad(ByteBuffer* buf);
-  int getPix(const uint32_t index) { return pix[index]; }
-  bool getOpaque(const uint32_t index) { return opaque[index]; }
+  int getRow(const uint32_t y) const { return rows[y]; }
+  int getPix(const uint32_t index) const { return (rows[index >> 3] >> ((7 - (index & 7)) << 1)) & 3; }
+  bool getOpaque(const uint32_t y) const { return (opaque >> y) & 1; }
 
 private:
-	// Tile data:
-	array<int, 64> pix;
-	int fbIndex;
-	int tIndex;
-	//int x, y;
-	//int w, h;
-	int incX, incY;
-	int palIndex;
-	int tpri;
-	int c;
+	// Tile data, 2 bits per pixel with the leftmost pixel on top:
+	array<uint16_t, 8> rows;
+	uint8_t opaque;
 	bool initialized;
-	array<bool, 8> opaque;
 };
 
+// Copy of the screen texture, with the scan lines that changed since
+// the last upload.
 class frame_buffer {
 public:
+  static const size_t LINE_BYTES = RES_WIDTH * sizeof(int);
+
   static frame_buffer* get_frame_buffer();
 
   void rendered();
-  int  largest_updated_line() const { return m_largest_updated_line; }
+  void invalidate();
+  bool is_line_dirty(const int y) const { return m_dirty[y]; }
 
   int get_pixel(const int linear_order);
   int get_pixel(const int x, const int y);
 
   void set_pixel(const int linear_order, const int value);
   void set_pixel(const int x, const int y, const int value);
+  void set_line(const int y, const int* pixels);
+  void set_frame(const int* pixels);
+
+  void upload(SDL_Texture* texture);
+  uint64_t uploads() const { return m_uploads; }
+  uint64_t uploaded_rects() const { return m_uploaded_rects; }
+  uint64_t uploaded_bytes() const { return m_uploaded_bytes; }
+  uint64_t skipped_bytes() const { return m_skipped_bytes; }
 
   const void* data_ptr();
   const void* data_ptr(const int x, const int y);
-  
+
 private:
   frame_buffer();
 
   std::array<int, RES_PIXEL> m_buf;
-  int m_largest_updated_line;
+  std::bitset<RES_HEIGHT> m_dirty;
+  uint64_t m_uploads;
+  uint64_t m_uploaded_rects;
+  uint64_t m_uploaded_bytes;
+  uint64_t m_skipped_bytes;
 };
 
 class PPU : public enable_shared_from_this<PPU> {
 public:
 	shared_ptr<NES> nes;
 	static const size_t UNDER_SCAN;
+	static const int SPRITE_BEHIND;
 	int _zoom;
 	struct timeval _frame_start;
 	struct timeval _frame_end;
 	double _ticks_since_second;
 	uint32_t frameCounter;
+	shared_ptr<Memory> cpuMem;
 	shared_ptr<Memory> ppuMem;
 	shared_ptr<Memory> sprMem;
 	// Rendering Options:
@@ -1248,7 +1719,6 @@ public:
 	int vramTmpAddress;
 	uint16_t vramBufferedReadValue;
 	bool firstWrite; 		// VRAM/Scroll Hi/Lo latch
-	array<int, 0x8000> vramMirrorTable; // Mirroring Lookup Table.
 	int i;
 
 	// SPR-RAM I/O:
@@ -1274,7 +1744,6 @@ public:
 	int vblankAdd;
 	int curX;
 	int scanline;
-	int lastRenderedScanline;
 	int mapperIrqCounter;
 	// Sprite data:
 	array<int,  N_SPRITES> sprX;				// X coordinate
@@ -1287,10 +1756,29 @@ public:
 	int spr0HitX;	// Sprite #0 hit X coordinate
 	int spr0HitY;	// Sprite #0 hit Y coordinate
 	bool hitSpr0;
+	// Scanline of a sprite #0 check that hasn't run yet:
+	int spr0CheckScan;
+	bool spr0CheckPending;
+
+	// Sprites on each scanline, in OAM order. Rebuilt when a Y coordinate
+	// or the sprite size changes:
+	array<array<uint8_t, N_SPRITES>, RES_HEIGHT> lineSprites;
+	array<uint8_t, RES_HEIGHT> lineSpriteCount;
+	bool spriteLinesDirty;
+	int spriteLinesSize;
 
 	// Tiles:
 	array<Tile, 512> ptTile;
 
+	// CHR-RAM tiles written since they were last decoded:
+	bitset<512> ptDirty;
+	bool ptAnyDirty;
+
+	// Pattern tables in 1KB banks of 64 tiles. They point at the ROM's
+	// CHR banks, or at ppuMem and ptTile for CHR-RAM:
+	array<const uint8_t*, 8> chrBank;
+	array<const Tile*, 8> ptBank;
+
 	// Name table data:
 	array<int, 4> ntable1;
 	array<NameTable, 4> nameTable;
@@ -1299,6 +1787,7 @@ public:
 	// Palette data:
 	array<int, 16> sprPalette;
 	array<int, 16> imgPalette;
+	const int* palColors;
 	// Misc:
 	bool scanlineAlreadyRendered;
 	bool requestEndFrame;
@@ -1311,15 +1800,18 @@ public:
 	int address, b1, b2;
 	// Variables used when rendering:
 	array<int, 32> attrib;
-	array<int, RES_PIXEL> bgbuffer;
-	array<int, RES_PIXEL> pixrendered;
+	// The line being drawn. Background pixels hold their image palette
+	// index, sprite pixels their sprite palette index, plus SPRITE_BEHIND
+	// for sprites behind the background. 0 is transparent.
+	array<int, RES_WIDTH> bgLine;
+	array<uint8_t, RES_WIDTH> spriteLine;
 	//vector<int> dummyPixPriTable;
 	array<int, 64>* tpix;
 	bool requestRenderAll;
 	bool validTileData;
 	int att;
-	array<Tile*, 32> scantile;
-	Tile* t;
+	array<const Tile*, 32> scantile;
+	const Tile* t;
 	// These are temporary variables used in rendering and sound procedures.
 	// Their states outside of those procedures can be ignored.
 	int curNt;
@@ -1331,9 +1823,18 @@ public:
 	int baseTile;
 	int tscanoffset;
 	int bufferSize, available;
+	// PPU cycles the CPU has run ahead, not yet emulated:
 	int cycles;
+	// PPU cycles until the next end of scanline or vblank NMI:
+	int nextEventCycles;
+
+	// Throughput counters:
+	uint64_t totalCycles;
+	uint64_t totalFrames;
 
-	array<int, RES_PIXEL> _screen_buffer;
+	// The frame being drawn, the back buffer of _frames:
+	array<int, RES_PIXEL>* _screen_buffer;
+	TripleBuffer _frames;
   frame_buffer* mp_frame_buffer;
 
 	array<int, RES_PIXEL>* get_screen_buffer();
@@ -1346,11 +1847,13 @@ public:
 	~PPU();
 	void init();
 	void setMirroring(int mirroring);
-	void defineMirrorRegion(size_t fromStart, size_t toStart, size_t size);
+	int mirrorAddress(int address) const;
 	bool emulateCycles();
+	void catchUp();
 	void startVBlank();
+	bool presentFrame();
+	void pollEvents();
 	void endScanline();
-	void startFrame();
 	void endFrame();
 	void updateControlReg1(int value);
 	void updateControlReg2(int value);
@@ -1372,20 +1875,34 @@ public:
 	uint16_t mirroredLoad(int address);
 	void mirroredWrite(int address, uint16_t value);
 	void triggerRendering();
-	void renderFramePartially(int startScan, int scanCount);
-	void renderBgScanline(array<int, RES_PIXEL>* buffer, int scan);
-	void renderSpritesPartially(int startscan, int scancount, bool bgPri);
+	int backgroundColor() const;
+	void renderScanline(int scan);
+	void renderBgScanline(int scan);
+	double benchmarkBgScanlines(int frames);
+	void evaluateSprites();
+	bool renderSpriteLine(int scan);
+	void requestSprite0Check(int scan);
 	bool checkSprite0(int scan);
 	void renderPattern();
 	void renderNameTables();
 	void renderPalettes();
 	void writeMem(int address, uint16_t value);
 	void updatePalettes();
-	void patternWrite(int address, uint16_t value);
-	void patternWrite(int address, vector<uint16_t>* value, size_t offset, size_t length);
+	void updatePaletteEntry(int index);
+	void patternWrite(int address);
+	const Tile& patternTile(int index) {
+		if(ptAnyDirty) {
+			decodeDirtyTiles();
+		}
+		return ptBank[index >> 6][index & 0x3F];
+	}
+	void decodeDirtyTiles();
+	void mapChrBanks(int address, int length, const uint8_t* data, const Tile* tiles);
+	void syncChrMemory();
 	void invalidateFrameCache();
 	void nameTableWrite(int index, int address, uint16_t value);
 	void attribTableWrite(int index, int address, uint16_t value);
+	void decodeSprites(int first);
 	void spriteRamWriteUpdate(int address, uint16_t value);
 	void doNMI();
 	int statusRegsToInt();
@@ -1434,11 +1951,12 @@ public:
 
 	bool failedSaveFile;
 	bool saveRamUpToDate;
-	array<uint16_t, 16> header;
-	vector<array<uint16_t, 16384>> rom;
-	vector<array<uint16_t, 4096>> vrom;
-	array<uint16_t, 0x2000>* saveRam;
+	array<uint8_t, 16> header;
+	vector<array<uint8_t, 16384>> rom;
+	vector<array<uint8_t, 4096>> vrom;
+	array<uint8_t, 0x2000>* saveRam;
 	vector<array<Tile, 256>> vromTile;
+	vector<bool> vromTileDecoded; // Banks are decoded when first mapped
 	shared_ptr<NES> nes;
 	size_t romCount;
 	size_t vromCount;
@@ -1457,14 +1975,15 @@ public:
 	~ROM();
 	string sha256sum(uint8_t* data, size_t length);
 	string getmapperName();
-	void load_from_data(const std::string& file_name, vector<uint8_t>* data, array<uint16_t, 0x2000>* save_ram);
+	void load_from_data(const std::string& file_name, vector<uint8_t>* data, array<uint8_t, 0x2000>* save_ram);
 	bool isValid();
 	int getRomBankCount();
 	int getVromBankCount();
-	array<uint16_t, 16> getHeader();
-	array<uint16_t, 16384>* getRomBank(int bank);
-	array<uint16_t, 4096>* getVromBank(int bank);
+	array<uint8_t, 16> getHeader();
+	array<uint8_t, 16384>* getRomBank(int bank);
+	array<uint8_t, 4096>* getVromBank(int bank);
 	array<Tile, 256>* getVromBankTiles(int bank);
+	void decodeVromBank(int bank);
 	int getMirroringType();
 	size_t getMapperType();
 	string getMapperName();
@@ -1474,7 +1993,7 @@ public:
 	bool mapperSupported();
 	shared_ptr<MapperDefault> createMapper();
 	void setSaveState(bool enableSave);
-	array<uint16_t, 0x2000>* getBatteryRam();
+	array<uint8_t, 0x2000>* getBatteryRam();
 	void loadBatteryRam();
 	void writeBatteryRam(int address, uint16_t value);
 	void closeRom();
@@ -1490,7 +2009,7 @@ public:
 	SaltyNES();
 	~SaltyNES();
 	void init();
-	void load_rom(string rom_name, vector<uint8_t>* rom_data, array<uint16_t, 0x2000>* save_ram);
+	void load_rom(string rom_name, vector<uint8_t>* rom_data, array<uint8_t, 0x2000>* save_ram);
 	void run();
 	void stop();
 	void readParams();
@@ -10,19 +10,12 @@ Hosted at: https://github.com/workhorsy/SaltyNES
 
 Tile::Tile() {
 	// Tile data:
-	pix.fill(0);
-	fbIndex = 0;
-	tIndex = 0;
-	incX = 0;
-	incY = 0;
-	palIndex = 0;
-	tpri = 0;
-	c = 0;
+	rows.fill(0);
+	opaque = 0;
 	initialized = false;
-	opaque.fill(false);
 }
 
-void Tile::setBuffer(vector<uint16_t>* scanline) {
+void Tile::setBuffer(vector<uint8_t>* scanline) {
 	for (int y = 0; y < 8; ++y) {
 		setScanline(y, (*scanline)[y], (*scanline)[y + 8]);
 	}
@@ -30,21 +23,27 @@ void Tile::setBuffer(vector<uint16_t>* scanline) {
 
 void Tile::setScanline(int sline, uint16_t b1, uint16_t b2) {
 	initialized = true;
-	tIndex = sline << 3;
+	int row = 0;
 	for (int x = 0; x < 8; ++x) {
-		pix[tIndex + x] = ((b1 >> (7 - x)) & 1) + (((b2 >> (7 - x)) & 1) << 1);
-		if(pix[tIndex + x] == 0) {
-			opaque[sline] = false;
-		}
+		row = (row << 2) | ((b1 >> (7 - x)) & 1) | (((b2 >> (7 - x)) & 1) << 1);
+	}
+	rows[sline] = static_cast<uint16_t>(row);
+
+	// The row is opaque when none of its pixels are 0:
+	if(((b1 | b2) & 0xFF) == 0xFF) {
+		opaque |= (1 << sline);
+	} else {
+		opaque &= ~(1 << sline);
 	}
 }
 
-void Tile::renderSimple(int dx, int dy, vector<int>* fBuffer, int palAdd, int* palette) {
-	tIndex = 0;
-	fbIndex = (dy << 8) + dx;
+void Tile::renderSimple(int dx, int dy, vector<int>* fBuffer, int palAdd, int* palette) const {
+	int palIndex;
+	int tIndex = 0;
+	int fbIndex = (dy << 8) + dx;
 	for(int y = 8; y != 0; --y) {
 		for(int x = 8; x != 0; --x) {
-			palIndex = pix[tIndex];
+			palIndex = getPix(tIndex);
 			if(palIndex != 0) {
 				(*fBuffer)[fbIndex] = palette[palIndex + palAdd];
 			}
@@ -56,16 +55,17 @@ void Tile::renderSimple(int dx, int dy, vector<int>* fBuffer, int palAdd, int* p
 	}
 }
 
-void Tile::renderSmall(int dx, int dy, vector<int>* buffer, int palAdd, int* palette) {
-	tIndex = 0;
-	fbIndex = (dy << 8) + dx;
+void Tile::renderSmall(int dx, int dy, vector<int>* buffer, int palAdd, int* palette) const {
+	int c;
+	int tIndex = 0;
+	int fbIndex = (dy << 8) + dx;
 	for (int y = 0; y < 4; ++y) {
 		for (int x = 0; x < 4; ++x) {
 
-			c = (palette[pix[tIndex] + palAdd] >> 2) & 0x003F3F3F;
-			c += (palette[pix[tIndex + 1] + palAdd] >> 2) & 0x003F3F3F;
-			c += (palette[pix[tIndex + 8] + palAdd] >> 2) & 0x003F3F3F;
-			c += (palette[pix[tIndex + 9] + palAdd] >> 2) & 0x003F3F3F;
+			c = (palette[getPix(tIndex) + palAdd] >> 2) & 0x003F3F3F;
+			c += (palette[getPix(tIndex + 1) + palAdd] >> 2) & 0x003F3F3F;
+			c += (palette[getPix(tIndex + 8) + palAdd] >> 2) & 0x003F3F3F;
+			c += (palette[getPix(tIndex + 9) + palAdd] >> 2) & 0x003F3F3F;
 			(*buffer)[fbIndex] = c;
 			++fbIndex;
 			tIndex += 2;
@@ -76,142 +76,18 @@ void Tile::renderSmall(int dx, int dy, vector<int>* buffer, int palAdd, int* pal
 
 }
 
-void Tile::render(
-    int srcx1, int srcy1, int srcx2, int srcy2, /* starting/ending point in the tile */
-    int dx, int dy, /* starting point in the screen */
-    array<int, RES_PIXEL>* fBuffer, int palAdd,
-    array<int, 16>* palette,
-    bool flipHorizontal, bool flipVertical, int pri,
-    array<int, RES_PIXEL>* priTable) {
-	if (dx < -7 || dx >= RES_WIDTH || dy < -7 || dy >= RES_HEIGHT) {
-		return;
-	}
-
-	int w = srcx2 - srcx1;
-	int h = srcy2 - srcy1;
-
-	if (dx < 0) {
-		srcx1 -= dx;
-	}
-
-	if (dx + srcx2 >= RES_WIDTH) {
-		srcx2 = RES_WIDTH - dx;
-	}
-
-	if(dy < 0) {
-		srcy1 -= dy;
-	}
-	if(dy + srcy2 >= RES_HEIGHT) {
-		srcy2 = RES_HEIGHT - dy;
-	}
-
-  /* no flip */
-	if (!flipHorizontal && !flipVertical) {
-		fbIndex = (dy << 8) + dx;
-		tIndex = 0;
-		for (int y = 0; y < 8; ++y) {
-			for (int x = 0; x < 8; ++x) {
-				if (srcx1 <= x && x < srcx2 &&
-            srcy1 <= y && y < srcy2) {
-					palIndex = pix[tIndex];
-					tpri = (*priTable)[fbIndex];
-					if (palIndex != 0 && pri <= (tpri & 0xFF)) {
-            /* fill the color */
-						(*fBuffer)[fbIndex] = (*palette)[palIndex + palAdd];
-						tpri = (tpri & 0xF00) | pri;
-						(*priTable)[fbIndex] = tpri;
-					}
-				}
-				++fbIndex;
-				++tIndex;
-			}
-			fbIndex -= 8;
-			fbIndex += 256;
-		}
-
-	} else if(flipHorizontal && !flipVertical) {
-
-		fbIndex = (dy << 8) + dx;
-		tIndex = 7;
-		for (int y = 0; y < 8; ++y) {
-			for (int x = 0; x < 8; ++x) {
-				if(x >= srcx1 && x < srcx2 && y >= srcy1 && y < srcy2) {
-					palIndex = pix[tIndex];
-					tpri = (*priTable)[fbIndex];
-					if(palIndex != 0 && pri <= (tpri & 0xFF)) {
-						(*fBuffer)[fbIndex] = (*palette)[palIndex + palAdd];
-						tpri = (tpri & 0xF00) | pri;
-						(*priTable)[fbIndex] = tpri;
-					}
-				}
-				++fbIndex;
-				--tIndex;
-			}
-			fbIndex -= 8;
-			fbIndex += 256;
-			tIndex += 16;
-		}
-
-	} else if(flipVertical && !flipHorizontal) {
-
-		fbIndex = (dy << 8) + dx;
-		tIndex = 56;
-		for (int y = 0; y < 8; ++y) {
-			for (int x = 0; x < 8; ++x) {
-				if(x >= srcx1 && x < srcx2 && y >= srcy1 && y < srcy2) {
-					palIndex = pix[tIndex];
-					tpri = (*priTable)[fbIndex];
-					if(palIndex != 0 && pri <= (tpri & 0xFF)) {
-						(*fBuffer)[fbIndex] = (*palette)[palIndex + palAdd];
-						tpri = (tpri & 0xF00) | pri;
-						(*priTable)[fbIndex] = tpri;
-					}
-				}
-				++fbIndex;
-				++tIndex;
-			}
-			fbIndex -= 8;
-			fbIndex += 256;
-			tIndex -= 16;
-		}
-
-	} else {
-
-		fbIndex = (dy << 8) + dx;
-		tIndex = 63;
-		for(int y = 0; y < 8; ++y) {
-			for(int x = 0; x < 8; ++x) {
-				if(x >= srcx1 && x < srcx2 && y >= srcy1 && y < srcy2) {
-					palIndex = pix[tIndex];
-					tpri = (*priTable)[fbIndex];
-					if(palIndex != 0 && pri <= (tpri & 0xFF)) {
-						(*fBuffer)[fbIndex] = (*palette)[palIndex + palAdd];
-						tpri = (tpri & 0xF00) | pri;
-						(*priTable)[fbIndex] = tpri;
-					}
-				}
-				++fbIndex;
-				--tIndex;
-			}
-			fbIndex -= 8;
-			fbIndex += 256;
-		}
-
-	}
+bool Tile::isTransparent(int x, int y) const {
+	return (getPix((y << 3) + x) == 0);
 }
 
-bool Tile::isTransparent(int x, int y) {
-	return (pix[(y << 3) + x] == 0);
-}
-
-void Tile::dumpData(string file) {
+void Tile::dumpData(string file) const {
 	try {
 
 		ofstream writer(file.c_str(), ios::out|ios::binary);
 		string chunk;
 		for(int y = 0; y < 8; ++y) {
 			for(int x = 0; x < 8; ++x) {
-				chunk = Misc::hex8(pix[(y << 3) + x]).substr(1);
+				chunk = Misc::hex8(getPix((y << 3) + x)).substr(1);
 				writer.write(chunk.c_str(), chunk.length());
 			}
 			chunk = "\r\n";
@@ -227,22 +103,28 @@ void Tile::dumpData(string file) {
 	}
 }
 
-void Tile::stateSave(ByteBuffer* buf) {
+// Saved as one byte per pixel, the packed rows are an in memory format.
+void Tile::stateSave(ByteBuffer* buf) const {
 	buf->putBoolean(initialized);
 	for(int i = 0; i < 8; ++i) {
-		buf->putBoolean(opaque[i]);
+		buf->putBoolean(getOpaque(i));
 	}
 	for(int i = 0; i < 64; ++i) {
-		buf->putByte(static_cast<uint8_t>(pix[i]));
+		buf->putByte(static_cast<uint8_t>(getPix(i)));
 	}
 }
 
 void Tile::stateLoad(ByteBuffer* buf) {
 	initialized = buf->readBoolean();
+	opaque = 0;
 	for(int i = 0; i < 8; ++i) {
-		opaque[i] = buf->readBoolean();
+		opaque |= (buf->readBoolean() ? 1 : 0) << i;
 	}
-	for(int i = 0; i < 64; ++i) {
-		pix[i] = buf->readByte();
+	for(int y = 0; y < 8; ++y) {
+		int row = 0;
+		for(int x = 0; x < 8; ++x) {
+			row = (row << 2) | (buf->readByte() & 3);
+		}
+		rows[y] = static_cast<uint16_t>(row);
 	}
 }
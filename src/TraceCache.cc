@@ -0,0 +1,123 @@
+/*
+Copyright (c) 2012-2017 Matthew Brennan Jones <matthew.brennan.jones@gmail.com>
+A NES emulator in WebAssembly. Based on vNES.
+Licensed under GPLV3 or later
+Hosted at: https://github.com/workhorsy/SaltyNES
+*/
+
+#include "SaltyNES.h"
+
+TraceCache::TraceCache() :
+    m_entries(KB(32)),
+    m_hits(0),
+    m_decodes(0),
+    m_invalidations(0) {
+  clear();
+}
+
+// Returns the trace starting at address, decoding it on a miss.
+// Returns nullptr where no trace can start: at an invalid opcode, or
+// an instruction whose operand is in the next slot.
+const TraceCache::Trace* TraceCache::lookup(int address, MapperDefault* mapper) {
+  const int index = address - BASE;
+  const int slot = index / SLOT_SIZE;
+  Entry& entry = m_entries[index];
+  if (entry.gen == m_gen[slot]) {
+    ++m_hits;
+    return &m_traces[slot][entry.trace];
+  }
+
+  Trace trace;
+  if (not decode(address, mapper, &trace)) {
+    return nullptr;
+  }
+  entry.gen = m_gen[slot];
+  entry.trace = m_traces[slot].size();
+  m_traces[slot].push_back(trace);
+  ++m_decodes;
+  return &m_traces[slot].back();
+}
+
+// Decodes the instructions from address up to and including the next one
+// that can change the program counter. It also stops before an invalid
+// opcode, an instruction that crosses into the next slot, or at MAX_OPS.
+bool TraceCache::decode(int address, MapperDefault* mapper, Trace* trace) {
+  const int slot = (address - BASE) / SLOT_SIZE;
+  int max_cycles = 0;
+  trace->length = 0;
+  while (trace->length < MAX_OPS) {
+    const int opcode = mapper->load(address);
+    const int info = CpuInfo::opdata[opcode];
+    const int inst = info & 0xFF;
+    const int addr_mode = (info >> 8) & 0xFF;
+    const int size = (info >> 16) & 0xFF;
+    if (size == 0 || (address + size - 1 - BASE) / SLOT_SIZE != slot) {
+      break;
+    }
+
+    // ROM reads have no side effects, so reading the operand early is safe:
+    Op& op = trace->ops[trace->length++];
+    op.opcode = opcode;
+    switch (size) {
+      case 2: op.operand = mapper->load(address + 1); break;
+      case 3: op.operand = mapper->load(address + 1) | (mapper->load(address + 2) << 8); break;
+      default: op.operand = 0; break;
+    }
+
+    max_cycles += (info >> 24) & 0xFF;
+    if (addr_mode >= CpuInfo::ADDR_ABSX && addr_mode <= CpuInfo::ADDR_POSTIDXIND) {
+      max_cycles += 1;
+    }
+
+    bool ends_trace = false;
+    switch (inst) {
+      case CpuInfo::INS_BCC: case CpuInfo::INS_BCS: case CpuInfo::INS_BEQ:
+      case CpuInfo::INS_BMI: case CpuInfo::INS_BNE: case CpuInfo::INS_BPL:
+      case CpuInfo::INS_BVC: case CpuInfo::INS_BVS:
+        max_cycles += 2;
+        ends_trace = true;
+        break;
+      case CpuInfo::INS_BRK: case CpuInfo::INS_JMP: case CpuInfo::INS_JSR:
+      case CpuInfo::INS_RTI: case CpuInfo::INS_RTS:
+        ends_trace = true;
+        break;
+      default:
+        break;
+    }
+    op.maxCycles = max_cycles;
+    if (ends_trace) {
+      return true;
+    }
+    address += size;
+  }
+  return trace->length > 0;
+}
+
+// Drops the traces of every slot in [address, address + length).
+void TraceCache::invalidate(int address, int length) {
+  if (address + length <= BASE || address > 0xFFFF) {
+    return;
+  }
+
+  const int first = std::max(address, BASE) - BASE;
+  const int last = std::min(address + length, 0x10000) - BASE - 1;
+  for (int slot = first / SLOT_SIZE; slot <= last / SLOT_SIZE; ++slot) {
+    ++m_invalidations;
+    m_traces[slot].clear();
+    // Generation 0 marks empty entries, don't wrap around to it:
+    if (++m_gen[slot] == 0) {
+      clear();
+      return;
+    }
+  }
+}
+
+void TraceCache::clear() {
+  for (auto& entry : m_entries) {
+    entry.gen = 0;
+  }
+  for (auto& traces : m_traces) {
+    traces.clear();
+  }
+  m_gen.fill(1);
+}
@@ -0,0 +1,41 @@
+/*
+Copyright (c) 2012-2017 Matthew Brennan Jones <matthew.brennan.jones@gmail.com>
+A NES emulator in WebAssembly. Based on vNES.
+Licensed under GPLV3 or later
+Hosted at: https://github.com/workhorsy/SaltyNES
+*/
+
+#include "SaltyNES.h"
+
+TripleBuffer::TripleBuffer() :
+    m_middle(1),
+    m_back(0),
+    m_front(2),
+    m_dropped(0) {
+  for (auto& frame : m_frames) {
+    frame.fill(0);
+  }
+}
+
+// Makes the back buffer the newest frame, and returns the buffer to draw
+// the next frame into. Only called by the emulation thread.
+TripleBuffer::Frame* TripleBuffer::publish() {
+  const uint8_t old = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+  if ((old & FRESH) != 0) {
+    // The presenter never saw that frame:
+    ++m_dropped;
+  }
+  m_back = old & 3;
+  return &m_frames[m_back];
+}
+
+// Returns the newest frame, or nullptr if none was published since the
+// last call. Only called by the presentation thread. The frame stays
+// valid until the next call.
+const TripleBuffer::Frame* TripleBuffer::consume() {
+  if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+    return nullptr;
+  }
+  m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & 3;
+  return &m_frames[m_front];
+}
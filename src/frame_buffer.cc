@@ -14,9 +14,14 @@ frame_buffer* frame_buffer::get_frame_buffer() {
   return singleton;
 }
 
-/* the screen buf has been displayed. reset the last updated scan line */
+/* the screen buf has been displayed. no line is dirty until it changes */
 void frame_buffer::rendered() {
-  m_largest_updated_line = -1;
+  m_dirty.reset();
+}
+
+/* the texture lost its contents, the next upload sends every line */
+void frame_buffer::invalidate() {
+  m_dirty.set();
 }
 
 int frame_buffer::get_pixel(const int linear_order) {
@@ -29,9 +34,8 @@ int frame_buffer::get_pixel(const int x, const int y) {
 }
 
 void frame_buffer::set_pixel(const int linear_order, const int value) {
-  const int pos_y = linear_order / RES_WIDTH;
-  if (m_buf[pos_y] != value) {
-    m_largest_updated_line = std::max(m_largest_updated_line, pos_y);
+  if (m_buf[linear_order] != value) {
+    m_dirty.set(linear_order / RES_WIDTH);
     m_buf[linear_order] = value;
   }
 }
@@ -39,11 +43,66 @@ void frame_buffer::set_pixel(const int linear_order, const int value) {
 void frame_buffer::set_pixel(const int x, const int y, const int value) {
   const int offset = y * RES_WIDTH + x;
   if (m_buf[offset] != value) {
-    m_largest_updated_line = std::max(m_largest_updated_line, y);
+    m_dirty.set(y);
     m_buf[offset] = value;
   }
 }
 
+/* copies a whole scan line, it is only marked dirty if a pixel changed */
+void frame_buffer::set_line(const int y, const int* pixels) {
+  int* const line = m_buf.data() + y * RES_WIDTH;
+  if (std::memcmp(line, pixels, LINE_BYTES) != 0) {
+    std::memcpy(line, pixels, LINE_BYTES);
+    m_dirty.set(y);
+  }
+}
+
+/* copies the frame one line at a time, to find the lines that changed */
+void frame_buffer::set_frame(const int* pixels) {
+  for (uint32_t y = 0; y < RES_HEIGHT; ++y) {
+    set_line(y, pixels + y * RES_WIDTH);
+  }
+}
+
+/*
+  Uploads each run of dirty lines as one rectangle, through a lock of
+  the streaming texture. The clean lines are left as they are in the
+  texture and counted as skipped. A run whose lock fails stays dirty,
+  so the next upload sends it again.
+ */
+void frame_buffer::upload(SDL_Texture* texture) {
+  m_skipped_bytes += (RES_HEIGHT - m_dirty.count()) * LINE_BYTES;
+
+  uint32_t y = 0;
+  while (y < RES_HEIGHT) {
+    if (!m_dirty[y]) {
+      ++y;
+      continue;
+    }
+
+    uint32_t end = y + 1;
+    while (end < RES_HEIGHT && m_dirty[end]) {
+      ++end;
+    }
+
+    const SDL_Rect rect = { 0, static_cast<int>(y), RES_WIDTH, static_cast<int>(end - y) };
+    void* pixels = nullptr;
+    int pitch = 0;
+    if (SDL_LockTexture(texture, &rect, &pixels, &pitch) == 0) {
+      for (uint32_t line = y; line < end; ++line) {
+        std::memcpy(static_cast<uint8_t*>(pixels) + (line - y) * pitch, data_ptr(0, line), LINE_BYTES);
+        m_dirty.reset(line);
+      }
+      SDL_UnlockTexture(texture);
+      m_uploaded_bytes += (end - y) * LINE_BYTES;
+      ++m_uploaded_rects;
+    }
+    y = end;
+  }
+
+  ++m_uploads;
+}
+
 const void* frame_buffer::data_ptr() {
   return data_ptr(0, 0);
 }
@@ -52,8 +111,12 @@ const void* frame_buffer::data_ptr(const int x, const int y) {
   const size_t offset = (y * RES_WIDTH + x);
   return (const void*)(m_buf.data() + offset);
 }
-  
+
 frame_buffer::frame_buffer() :
-    m_largest_updated_line(RES_HEIGHT) {
+    m_uploads(0),
+    m_uploaded_rects(0),
+    m_uploaded_bytes(0),
+    m_skipped_bytes(0) {
   std::fill(m_buf.begin(), m_buf.end(), 0);
+  m_dirty.set();
 }
@@ -15,6 +15,13 @@ SaltyNES salty_nes;
 vector<uint8_t> g_game_data;
 string g_game_file_name;
 
+// Headless output and run length
+static MemoryVideoSink g_video_sink;
+static MemoryAudioSink g_audio_sink(MB(1));
+static size_t g_frame_limit = 0; // 0 means run until quit
+static size_t g_frames_run = 0;
+static size_t g_benchmark_frames = 0;
+
 void set_is_windows() {
   Globals::is_windows = true;
 }
@@ -57,6 +64,11 @@ void on_emultor_loop() {
   if (salty_nes.nes) {
     salty_nes.nes->getCpu()->emulate_frame();
 
+    ++g_frames_run;
+    if (g_frame_limit > 0 && g_frames_run >= g_frame_limit) {
+      salty_nes.nes->getCpu()->stopRunning = true;
+    }
+
     if (salty_nes.nes->getCpu()->stopRunning) {
 #ifdef WEB
       emscripten_cancel_main_loop();
@@ -65,14 +77,50 @@ void on_emultor_loop() {
   }
 }
 
-void start_main_loop() {
 #ifdef DESKTOP
+static void* emulation_thread(void*) {
   while (! salty_nes.nes->getCpu()->stopRunning) {
     on_emultor_loop();
   }
+  return nullptr;
+}
+
+// Runs the emulation on its own thread. The main thread, which SDL wants
+// for rendering and events, shows the newest frame whenever there is one.
+static void run_with_render_thread() {
+  const shared_ptr<CPU> cpu = salty_nes.nes->getCpu();
+  const shared_ptr<PPU> ppu = salty_nes.nes->getPpu();
+  pthread_t emulation;
+  if (pthread_create(&emulation, nullptr, emulation_thread, nullptr) != 0) {
+    fprintf(stderr, "Couldn't start the emulation thread, presenting inline\n");
+    Globals::renderThread = false;
+    emulation_thread(nullptr);
+    return;
+  }
+
+  while (! cpu->stopRunning) {
+    ppu->pollEvents();
+    if (! ppu->presentFrame()) {
+      SDL_Delay(1);
+    }
+  }
+  pthread_join(emulation, nullptr);
+}
+#endif
+
+void start_main_loop() {
+#ifdef DESKTOP
+  if (Globals::renderThread && ! Globals::headless) {
+    run_with_render_thread();
+  } else {
+    emulation_thread(nullptr);
+  }
 #endif
 
 #ifdef WEB
+  // The browser runs a single thread, frames are shown as they finish
+  Globals::renderThread = false;
+
   // Tell the web app that everything is loaded
   EM_ASM_ARGS({
     onReady();
@@ -121,6 +169,163 @@ EMSCRIPTEN_BINDINGS(Wrappers) {
 };
 #endif
 
+static void print_throughput_report(const double seconds) {
+  const shared_ptr<CPU> cpu = salty_nes.nes->getCpu();
+  const shared_ptr<PPU> ppu = salty_nes.nes->getPpu();
+  printf("throughput: %.2f s, %llu frames, %.1f frames/s, %.2f M instructions/s, %.2f M PPU cycles/s\n",
+      seconds,
+      static_cast<unsigned long long>(ppu->totalFrames),
+      ppu->totalFrames / seconds,
+      cpu->totalInstructions / seconds / 1000000.0,
+      ppu->totalCycles / seconds / 1000000.0);
+
+  if (cpu->idleSkips > 0) {
+    printf("idle loops: %llu skips, %llu instructions, %.1f%% of CPU cycles skipped\n",
+        static_cast<unsigned long long>(cpu->idleSkips),
+        static_cast<unsigned long long>(cpu->idleSkippedInstructions),
+        ppu->totalCycles > 0 ? 100.0 * cpu->idleSkippedCycles * 3 / ppu->totalCycles : 0.0);
+  }
+
+  if (Globals::traceCache) {
+    const TraceCache& trace = cpu->trace;
+    printf("trace cache: %.1f%% of instructions run in traces, %.1f instructions per trace, %llu decodes, %llu invalidations\n",
+        cpu->totalInstructions > 0 ? 100.0 * cpu->tracedInstructions / cpu->totalInstructions : 0.0,
+        cpu->traceRuns > 0 ? static_cast<double>(cpu->tracedInstructions) / cpu->traceRuns : 0.0,
+        static_cast<unsigned long long>(trace.decodes()),
+        static_cast<unsigned long long>(trace.invalidations()));
+  }
+}
+
+static void print_upload_report() {
+  const frame_buffer* frame = frame_buffer::get_frame_buffer();
+  const uint64_t total = frame->uploaded_bytes() + frame->skipped_bytes();
+  printf("screen uploads: %llu frames, %llu rects, %.1f MB sent, %.1f MB skipped (%.1f%% of the frame bytes)\n",
+      static_cast<unsigned long long>(frame->uploads()),
+      static_cast<unsigned long long>(frame->uploaded_rects()),
+      frame->uploaded_bytes() / 1000000.0,
+      frame->skipped_bytes() / 1000000.0,
+      total > 0 ? 100.0 * frame->skipped_bytes() / total : 0.0);
+  printf("frames replaced before they were shown: %llu\n",
+      static_cast<unsigned long long>(salty_nes.nes->getPpu()->_frames.dropped()));
+}
+
+static void print_headless_report() {
+  printf("headless: %zu frames, last frame checksum %08x, %zu audio bytes\n",
+      g_video_sink.frame_count(),
+      g_video_sink.checksum(),
+      g_audio_sink.total_bytes());
+}
+
+// Returns the resident set size in KB, or 0 where it is not available.
+static size_t resident_kb() {
+#ifdef __linux__
+  ifstream status("/proc/self/status");
+  string line;
+  while (getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      return strtoul(line.c_str() + 6, nullptr, 10);
+    }
+  }
+#endif
+  return 0;
+}
+
+// Fixed workload for comparing builds: headless, unpaced, no sinks.
+// The warm up frames are not counted.
+static void run_benchmark(const size_t frames) {
+  const size_t warm_up_frames = 60;
+  const size_t start_kb = resident_kb();
+  on_emultor_start();
+  const shared_ptr<CPU> cpu = salty_nes.nes->getCpu();
+  const shared_ptr<PPU> ppu = salty_nes.nes->getPpu();
+  for (size_t i = 0; i < warm_up_frames; ++i) {
+    cpu->emulate_frame();
+  }
+
+  cpu->totalInstructions = 0;
+  cpu->idleSkips = 0;
+  cpu->idleSkippedInstructions = 0;
+  cpu->idleSkippedCycles = 0;
+  cpu->traceRuns = 0;
+  cpu->tracedInstructions = 0;
+  ppu->totalCycles = 0;
+  ppu->totalFrames = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < frames && !cpu->stopRunning; ++i) {
+    cpu->emulate_frame();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  print_throughput_report(elapsed.count());
+
+  const size_t end_kb = resident_kb();
+  if (end_kb > 0) {
+    printf("memory: %zu KB resident, %zu KB for the emulator and loaded game\n", end_kb, end_kb - start_kb);
+  }
+
+  // Background renderer alone, on the last frame's scroll and tiles:
+  const int bg_frames = 200;
+  const bool simd_background = Globals::simdBackground;
+  Globals::simdBackground = true;
+  const double vector_ns = ppu->benchmarkBgScanlines(bg_frames);
+  Globals::simdBackground = false;
+  const double scalar_ns = ppu->benchmarkBgScanlines(bg_frames);
+  Globals::simdBackground = simd_background;
+  printf("background: %.1f ns/scanline vector, %.1f ns/scanline scalar\n", vector_ns, scalar_ns);
+}
+
+// Returns the rom file name, or nullptr if the arguments are bad
+static const char* parse_args(int argc, char* argv[]) {
+  const char* rom_file = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    if (arg == "--headless") {
+      Globals::headless = true;
+    } else if (arg == "--uncapped") {
+      Globals::uncapped = true;
+    } else if (arg == "--trace-cache") {
+      Globals::traceCache = true;
+    } else if (arg == "--no-idle-skip") {
+      Globals::idleSkip = false;
+    } else if (arg == "--no-simd-bg") {
+      Globals::simdBackground = false;
+    } else if (arg == "--sprite-limit") {
+      Globals::spriteLimit = true;
+    } else if (arg == "--no-render-thread") {
+      Globals::renderThread = false;
+    } else if (arg == "--frames" && i + 1 < argc) {
+      g_frame_limit = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--benchmark" && i + 1 < argc) {
+      g_benchmark_frames = strtoul(argv[++i], nullptr, 10);
+      Globals::headless = true;
+      Globals::uncapped = true;
+    } else if (startsWith(arg, "--")) {
+      fprintf(stderr, "Unknown option '%s'\n", arg.c_str());
+      return nullptr;
+    } else {
+      rom_file = argv[i];
+    }
+  }
+  return rom_file;
+}
+
+// Picks the texture format the renderer prefers, out of the ones the
+// palette can be made in, so frames upload without a conversion.
+static uint32_t choose_screen_format(SDL_Renderer* renderer) {
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(renderer, &info) == 0) {
+    for (uint32_t i = 0; i < info.num_texture_formats; ++i) {
+      switch (info.texture_formats[i]) {
+        case SDL_PIXELFORMAT_ARGB8888:
+        case SDL_PIXELFORMAT_ABGR8888:
+        case SDL_PIXELFORMAT_RGB888:
+        case SDL_PIXELFORMAT_BGR888:
+          return info.texture_formats[i];
+      }
+    }
+  }
+  return SDL_PIXELFORMAT_BGR888;
+}
+
 static void init_ttf() {
   TTF_Init();
   static SDL_Color color = { 255, 255, 128, 64 };
@@ -139,15 +344,36 @@ int main(int argc, char* argv[]) {
 
   // Make sure there is a rom file name
 #ifdef DESKTOP
-    if (argc < 2) {
+    const char* rom_file = parse_args(argc, argv);
+    if (rom_file == nullptr) {
       fprintf(stderr, "No rom file argument provided. Exiting ...\n");
+      fprintf(stderr, "Usage: %s [--headless] [--uncapped] [--trace-cache] [--no-idle-skip] [--no-simd-bg] [--sprite-limit] [--no-render-thread] [--frames N] [--benchmark N] game.nes\n", argv[0]);
       return -1;
     }
-    set_game_data_from_file(argv[1]);
+    set_game_data_from_file(rom_file);
 #else    
     g_game_file_name = "rom_from_browser.nes";
 #endif
 
+  if (g_benchmark_frames > 0) {
+    run_benchmark(g_benchmark_frames);
+    return 0;
+  }
+
+  // Headless skips SDL entirely and renders into memory
+  if (Globals::headless) {
+    Globals::video_sink = &g_video_sink;
+    Globals::audio_sink = &g_audio_sink;
+    on_emultor_start();
+    mlog("headless emulation started");
+    const auto start = std::chrono::steady_clock::now();
+    start_main_loop();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    print_headless_report();
+    print_throughput_report(elapsed.count());
+    return 0;
+  }
+
   // Initialize SDL
   auto ret = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_JOYSTICK);
   merr(ret == 0, "Could not initialize SDL: %s", SDL_GetError());
@@ -175,21 +401,29 @@ int main(int argc, char* argv[]) {
   SDL_RenderSetLogicalSize(Globals::g_renderer, RES_WIDTH, RES_HEIGHT);
 
   // Create the SDL texture
+  Globals::g_screen_format = choose_screen_format(Globals::g_renderer);
   Globals::g_screen =
       SDL_CreateTexture(
           Globals::g_renderer,
-          SDL_PIXELFORMAT_BGR888,
-          SDL_TEXTUREACCESS_STATIC,
+          Globals::g_screen_format,
+          SDL_TEXTUREACCESS_STREAMING,
           RES_WIDTH, RES_HEIGHT);
   merr(
       Globals::g_screen,
       "Couldn't create a teture: %s", SDL_GetError());
+  SDL_SetTextureBlendMode(Globals::g_screen, SDL_BLENDMODE_NONE);
 
 #ifdef DESKTOP
   on_emultor_start();
 #endif
 
   mlog("emulation started");
+  const auto start = std::chrono::steady_clock::now();
   start_main_loop();
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  if (Globals::uncapped) {
+    print_throughput_report(elapsed.count());
+  }
+  print_upload_report();
   return 0;
 }